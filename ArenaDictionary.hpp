@@ -0,0 +1,305 @@
+#ifndef ARENADICTIONARY_EX6
+#define ARENADICTIONARY_EX6
+
+#include "HashMap.hpp"
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define ARENA_CHUNK_BYTES (1 << 20)
+#define ARENA_LARGE_BYTES (ARENA_CHUNK_BYTES / 4)
+
+/**
+ * StringArena class
+ * Append-only storage of string bytes in large chunks: storing a string is
+ * a copy into the current chunk, with one allocation per ARENA_CHUNK_BYTES
+ * bytes rather than one per string; freeing is all at once. A string of at
+ * least ARENA_LARGE_BYTES gets a chunk of its own, so it does not waste the
+ * rest of the current one. Stored bytes never move.
+ */
+class StringArena {
+  std::vector<std::unique_ptr<char[]>> chunks;
+  char *cur = nullptr; // Free bytes of the current chunk
+  size_t left = INIT;
+  size_t _capacity = INIT; // Bytes of all chunks
+
+ public:
+  StringArena () = default;
+
+  // Move only, a moved-from arena is empty and usable
+  StringArena (StringArena &&other) noexcept { *this = std::move (other); }
+  StringArena &operator= (StringArena &&other) noexcept
+  {
+    std::swap (chunks, other.chunks);
+    std::swap (cur, other.cur);
+    std::swap (left, other.left);
+    std::swap (_capacity, other._capacity);
+    return *this;
+  }
+
+  /**
+   * Copy s into the arena
+   * @return view of the copy, valid until clear () or destruction
+   */
+  ArenaString store (ArenaString s)
+  {
+    if (s.empty ())
+      {
+        return {};
+      }
+    if (s.size () >= ARENA_LARGE_BYTES)
+      {
+        chunks.emplace_back (new char[s.size ()]);
+        _capacity += s.size ();
+        std::memcpy (chunks.back ().get (), s.data (), s.size ());
+        return {chunks.back ().get (), s.size ()};
+      }
+    if (s.size () > left)
+      {
+        chunks.emplace_back (new char[ARENA_CHUNK_BYTES]);
+        _capacity += ARENA_CHUNK_BYTES;
+        cur = chunks.back ().get ();
+        left = ARENA_CHUNK_BYTES;
+      }
+    std::memcpy (cur, s.data (), s.size ());
+    ArenaString copy (cur, s.size ());
+    cur += s.size ();
+    left -= s.size ();
+    return copy;
+  }
+
+  size_t capacity () const { return _capacity; }
+
+  void clear ()
+  {
+    chunks.clear ();
+    cur = nullptr;
+    left = INIT;
+    _capacity = INIT;
+  }
+};
+
+/**
+ * ArenaDictionary class
+ * Dictionary whose key and value bytes live in a StringArena: every pair
+ * of the map is two views (ArenaString) into it, so building the dictionary
+ * makes no allocation per string and destroying it frees a few chunks.
+ * Erased and overwritten strings stay in the arena as dead bytes; once
+ * they outnumber the live bytes (and fill at least a chunk), the live
+ * strings are copied into a fresh arena and the old one is freed, so the
+ * arena stays at most about twice the live data.
+ * Views returned by at () and iteration are valid until the next change of
+ * the dictionary.
+ * Errors follow HashMap, not Dictionary: erase of a missing key returns
+ * false rather than raising InvalidKey, and at () raises
+ * std::invalid_argument.
+ */
+class ArenaDictionary {
+
+  // Private Members
+  typedef HashMap<ArenaString, ArenaString> map_type;
+  StringArena arena;
+  map_type map;
+  size_t _live_bytes = INIT; // Bytes of the strings of the pairs
+  size_t _dead_bytes = INIT; // Bytes of erased and overwritten strings
+
+  /**
+   * Compact if the dead bytes outnumber the live ones
+   */
+  void maybe_compact ()
+  {
+    if (_dead_bytes > _live_bytes && _dead_bytes >= ARENA_CHUNK_BYTES)
+      {
+        compact ();
+      }
+  }
+
+ public:
+  typedef map_type::const_iterator const_iterator;
+
+  // Constructors
+  ArenaDictionary () = default;
+
+  /**
+   * Main Constructor
+   * Gets a vector of keys and a vector of values and assigns the pairs by
+   * order, later values overwrite earlier ones
+   * @param key_vec
+   * @param value_vec
+   */
+  ArenaDictionary (const std::vector<std::string> &key_vec,
+                   const std::vector<std::string> &value_vec)
+  {
+    if (key_vec.size () != value_vec.size ())
+      {
+        throw std::length_error (VECTOR_LENGTH);
+      }
+    map.reserve ((int) key_vec.size ());
+    for (size_t i = 0; i < key_vec.size (); i++)
+      {
+        assign (key_vec[i], value_vec[i]);
+      }
+  }
+
+  // Copy (into a fresh arena of the live strings) and Move
+  ArenaDictionary (const ArenaDictionary &other) { *this = other; }
+  ArenaDictionary &operator= (const ArenaDictionary &other)
+  {
+    if (this != &other)
+      {
+        ArenaDictionary copy;
+        copy.map.reserve (other.size ());
+        for (const auto &pair : other)
+          {
+            copy.insert (pair.first, pair.second);
+          }
+        *this = std::move (copy);
+      }
+    return *this;
+  }
+  ArenaDictionary (ArenaDictionary &&other) noexcept
+  { *this = std::move (other); }
+  ArenaDictionary &operator= (ArenaDictionary &&other) noexcept
+  {
+    std::swap (arena, other.arena);
+    std::swap (map, other.map);
+    std::swap (_live_bytes, other._live_bytes);
+    std::swap (_dead_bytes, other._dead_bytes);
+    return *this;
+  }
+
+  // Getters and Checkers
+  int size () const { return map.size (); }
+  bool empty () const { return map.empty (); }
+  bool contains_key (ArenaString key) const
+  { return map.contains_key (key); }
+  size_t live_bytes () const { return _live_bytes; }
+  size_t dead_bytes () const { return _dead_bytes; }
+
+  /**
+   * Bytes held by the arena, live, dead and not used yet
+   */
+  size_t arena_bytes () const { return arena.capacity (); }
+
+  // Operations
+
+  /**
+   * Insert Function
+   * Copies key and value into the arena, if dictionary does not contain key
+   * @return true upon success
+   */
+  bool insert (ArenaString key, ArenaString value)
+  {
+    if (map.contains_key (key))
+      {
+        return false;
+      }
+    size_t bytes = key.size () + value.size ();
+    ArenaString stored_key = arena.store (key);
+    _dead_bytes += key.size (); // Until the pair is in the map
+    ArenaString stored_value = arena.store (value);
+    _dead_bytes += value.size ();
+    map.insert (stored_key, stored_value);
+    _dead_bytes -= bytes;
+    _live_bytes += bytes;
+    return true;
+  }
+
+  /**
+   * Assign Function
+   * Sets the value of key, inserting the pair if key does not exist. The
+   * old value becomes dead bytes.
+   */
+  void assign (ArenaString key, ArenaString value)
+  {
+    ArenaString *old = map.try_get (key);
+    if (!old)
+      {
+        insert (key, value);
+        return;
+      }
+    ArenaString stored = arena.store (value);
+    _dead_bytes += old->size ();
+    _live_bytes = _live_bytes - old->size () + value.size ();
+    *old = stored;
+    maybe_compact ();
+  }
+
+  /**
+   * Erase pair, its strings become dead bytes
+   * @return true upon success of operation
+   */
+  bool erase (ArenaString key)
+  {
+    const ArenaString *value = map.try_get (key);
+    if (!value)
+      {
+        return false;
+      }
+    size_t bytes = key.size () + value->size ();
+    map.erase (key);
+    _live_bytes -= bytes;
+    _dead_bytes += bytes;
+    maybe_compact ();
+    return true;
+  }
+
+  /**
+   * Clear all pairs and free the arena
+   */
+  void clear ()
+  {
+    map.clear ();
+    arena.clear ();
+    _live_bytes = _dead_bytes = INIT;
+  }
+
+  /**
+   * Compact Function
+   * Copies the live strings into a fresh arena and frees the old one
+   */
+  void compact ()
+  {
+    StringArena fresh;
+    map_type fresh_map;
+    fresh_map.reserve (map.size ());
+    for (const auto &pair : map)
+      {
+        fresh_map.insert (fresh.store (pair.first), fresh.store (pair.second));
+      }
+    std::swap (arena, fresh);
+    map = std::move (fresh_map);
+    _dead_bytes = INIT;
+  }
+
+  // Operators
+
+  /**
+   * At operator
+   * Raises exceptions if does not exist
+   * @param key
+   * @return view of the value of key
+   */
+  ArenaString at (ArenaString key) const { return map.at (key); }
+  ArenaString operator[] (ArenaString key) const
+  { return at (key); }
+
+  /**
+   * Operator ==
+   * @return true if both dictionaries hold the same pairs
+   */
+  bool operator== (const ArenaDictionary &other) const
+  { return map == other.map; }
+  bool operator!= (const ArenaDictionary &other) const
+  { return !(operator== (other)); }
+
+  // Begin & End functions, pairs of views
+  const_iterator begin () const { return map.begin (); }
+  const_iterator cbegin () const { return begin (); }
+  const_iterator end () const { return map.end (); }
+  const_iterator cend () const { return end (); }
+};
+
+#endif //ARENADICTIONARY_EX6
@@ -2,9 +2,28 @@
 #define DICTIONARY_EX6
 
 #include "HashMap.hpp"
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #define INVALID_MSG "Error: Invalid argument"
+#define LOAD_IO "Error: Could not read file"
+#define LOAD_LINES "Error: Too many lines to load"
+#define LOAD_CHUNK_BYTES (1 << 20)
 using std::string;
 
+/**
+ * Options of Dictionary::load_tsv
+ */
+struct tsv_options {
+    char delimiter = '\t'; // ',' for simple CSV (no quoting)
+    bool skip_header = false; // Ignore the first line
+    int threads = default_threads (); // Threads that parse and insert
+};
+
 /**
  * InvalidKey exception raising class
  * Inherits from std::invalid_argument class
@@ -21,15 +40,48 @@ class InvalidKey : public std::invalid_argument {
 /**
  * Dictionary class
  * Represents a inherited class of HashMap that maps string keys to string vals
+ * Like every HashMap of string keys, at, contains_key, erase, [] and the
+ * other lookups also take a const char * or (C++17) a std::string_view
+ * without building a string.
  */
 class Dictionary : public HashMap<string, string> {
+  template<class K>
+  bool erase_key (const K &key)
+  {
+    if (!HashMap<string, string>::erase (key))
+      {
+        auto error = InvalidKey ();
+      }
+    return true;
+  }
+
  public:
   // Constructors
+  Dictionary () = default;
   Dictionary (const std::vector<string> &key_vec, const std::vector<string>
       &value_vec)
       : HashMap<string, string> (key_vec, value_vec)
   {};
 
+  /**
+   * Load TSV Function
+   * Streams a file of key<delimiter>value lines into the dictionary, with
+   * the result of (*this)[key] = value for every line in order. The file is
+   * mapped, not read into strings: it is cut into chunks at line ends, the
+   * chunks are scanned on options.threads threads with memchr (vectorized
+   * in the C library) into the offsets of every key and value, and those go
+   * straight into the presized table (see bulk_assign). Empty lines are
+   * skipped, a trailing '\r' is dropped, the value is everything after the
+   * first delimiter. Throws std::runtime_error if the file cannot be read,
+   * std::invalid_argument for a line with no delimiter and
+   * std::length_error for more lines than a map can hold (INT_MAX).
+   * Inserts run on options.threads threads too.
+   * @param path
+   * @param options
+   */
+  void load_tsv (const string &path, const tsv_options &options
+      = tsv_options ());
+
   /**
    * A template iterator function to go throw unknown generic container
    * that contain pairs of string keys and values
@@ -48,16 +100,133 @@ class Dictionary : public HashMap<string, string> {
   /**
    * Override function of virtual erase function in HashMap class
    * differs from it by raising InvalidKey exception if key not found
-   * @param key
+   * @param key a string, or a transparent key as for HashMap::erase
    * @return true upon success
    */
-  bool erase (const string &key) override{
-    if (!HashMap<string, string>::erase (key))
+  bool erase (const string &key) override { return erase_key (key); }
+  template<class K, class = key_arg<K>>
+  bool erase (const K &key) { return erase_key (key); }
+  // Keeps the erase at iterator of HashMap visible
+  using HashMap<string, string>::erase;
+};
+
+inline void Dictionary::load_tsv (const string &path,
+                                  const tsv_options &options)
+{
+  int fd = open (path.c_str (), O_RDONLY);
+  struct stat info;
+  if (fd == -1 || fstat (fd, &info) == -1)
+    {
+      if (fd != -1)
+        {
+          close (fd);
+        }
+      throw std::runtime_error (LOAD_IO);
+    }
+  size_t length = (size_t) info.st_size;
+  if (length == INIT)
+    {
+      close (fd);
+      return;
+    }
+  void *mapping = mmap (nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (mapping == MAP_FAILED)
+    {
+      throw std::runtime_error (LOAD_IO);
+    }
+  madvise (mapping, length, MADV_SEQUENTIAL);
+  const char *text = (const char *) mapping, *text_end = text + length;
+
+  // A line, as offsets into the file
+  struct line {
+      size_t key, key_size, value_size;
+  };
+  int num_threads = std::max (1, options.threads);
+  int num_chunks = (int) std::min<size_t> ((size_t) num_threads
+      * CHUNKS_PER_THREAD, length / LOAD_CHUNK_BYTES + 1);
+  std::vector<std::vector<line>> chunk_lines (num_chunks);
+  // Chunk c holds the lines that start in [c * length / num_chunks, ...)
+  auto line_start = [&] (int c)
+  {
+    if (c == num_chunks)
       {
-        auto error = InvalidKey ();
+        return text_end;
       }
-    return true;
-  }
-};
+    const char *p = text + length * c / num_chunks;
+    if (c == INIT || p[-1] == '\n')
+      {
+        return p;
+      }
+    const char *eol = (const char *) std::memchr (p, '\n', text_end - p);
+    return eol ? eol + 1 : text_end;
+  };
+  try
+    {
+      run_work_stealing (num_chunks, num_threads, [&] (int c, int)
+      {
+        const char *p = line_start (c), *end = line_start (c + 1);
+        if (c == INIT && options.skip_header)
+          {
+            const char *eol = (const char *) std::memchr (p, '\n', end - p);
+            p = eol ? eol + 1 : end;
+          }
+        while (p < end)
+          {
+            const char *eol = (const char *) std::memchr (p, '\n', end - p);
+            const char *next = eol ? eol + 1 : end;
+            eol = eol ? eol : end;
+            if (eol > p && eol[-1] == '\r')
+              {
+                eol--;
+              }
+            if (eol > p)
+              {
+                const char *tab = (const char *) std::memchr
+                    (p, options.delimiter, eol - p);
+                if (!tab)
+                  {
+                    throw std::invalid_argument (INVALID_MSG);
+                  }
+                chunk_lines[c].push_back ({(size_t) (p - text),
+                                           (size_t) (tab - p),
+                                           (size_t) (eol - tab - 1)});
+              }
+            p = next;
+          }
+      });
+      std::vector<line> lines;
+      size_t total = INIT;
+      for (const auto &chunk : chunk_lines)
+        {
+          total += chunk.size ();
+        }
+      if (total > (size_t) INT_MAX)
+        {
+          throw std::length_error (LOAD_LINES);
+        }
+      lines.reserve (total);
+      for (auto &chunk : chunk_lines)
+        {
+          lines.insert (lines.end (), chunk.begin (), chunk.end ());
+          std::vector<line> ().swap (chunk);
+        }
+      // Keys are hashed and compared in the mapped text, a string is built
+      // only for a key that is inserted
+      bulk_assign ((int) lines.size (), [&] (int i)
+      { return ArenaString (text + lines[i].key, lines[i].key_size); },
+      [&] (int i)
+      {
+        return string (text + lines[i].key + lines[i].key_size + 1,
+                       lines[i].value_size);
+      }, num_threads);
+    }
+  catch (...)
+    {
+      munmap (mapping, length);
+      throw;
+    }
+  munmap (mapping, length);
+}
 
 #endif //DICTIONARY_EX6
\ No newline at end of file
@@ -0,0 +1,581 @@
+#ifndef FLATHASHMAP_EX6
+#define FLATHASHMAP_EX6
+
+#include "HashMap.hpp"
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <utility>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define GROUP_WIDTH 16
+#define CTRL_EMPTY ((int8_t) -128)
+#define CTRL_DELETED ((int8_t) -2)
+#define H2_BITS 7
+#define H2_MASK 0x7F
+#define FLAT_MAX_LOAD_NUM 7
+#define FLAT_MAX_LOAD_DEN 8
+
+/**
+ * FlatHashMap class
+ * Open-addressing storage engine with the same public API as HashMap.
+ * All pairs live in one contiguous slot array, next to a parallel array of
+ * 1-byte control tags (empty / deleted / 7 bits of the key's hash).
+ * Lookups probe GROUP_WIDTH tags at a time (with SSE2 when available) and only
+ * touch a slot when its tag matches, so a hit usually costs one cache miss.
+ * @tparam KeyT
+ * @tparam ValueT
+ */
+template<class KeyT, class ValueT>
+class FlatHashMap {
+
+  // Private Members
+  typedef std::pair<KeyT, ValueT> slot_type;
+  slot_type *slots; // Contiguous slot array, constructed only where full
+  int8_t *ctrl; // Control tag per slot
+  int _size = INIT; // Num of pairs in slot array
+  int _capacity = INIT_CAPACITY; // Num of slots, power of 2, >= GROUP_WIDTH
+  int _growth_left = INIT; // Inserts allowed into empty slots before rehash
+
+  // Private helper functions
+
+  /**
+   * Bit mask of the tags in a group that match a predicate.
+   * Bit i is set iff ctrl[i] matches.
+   */
+  static unsigned match_tag (const int8_t *group, int8_t tag);
+  static unsigned match_empty (const int8_t *group);
+  static unsigned match_empty_or_deleted (const int8_t *group);
+
+  /**
+   * Full hash of a key, mixed so both the group index (high bits) and the
+   * 7-bit tag (low bits) are well distributed even for identity hashes.
+   */
+  static size_t hash_key (const KeyT &key);
+
+  /**
+   * Find the slot holding key
+   * @return index of slot, or -1 if key does not exist
+   */
+  int find_index (const KeyT &key, size_t hash) const;
+
+  /**
+   * Find a free slot for a key that is known to be absent, growing or
+   * cleaning the table first if it ran out of empty slots.
+   * @return index of slot to construct the new pair in
+   */
+  int prepare_insert (size_t hash);
+
+  /**
+   * Allocate the slot and control arrays for new_capacity slots
+   * and move every pair into them.
+   * @param new_capacity
+   */
+  void rehash (int new_capacity);
+
+  /**
+   * Allocate empty arrays of the given capacity (no pairs are moved)
+   */
+  void allocate (int capacity);
+
+  /**
+   * Destroy all pairs and release the arrays
+   */
+  void destroy ();
+
+  void set_ctrl (int ind, int8_t tag) { ctrl[ind] = tag; }
+  int max_load () const
+  { return _capacity / FLAT_MAX_LOAD_DEN * FLAT_MAX_LOAD_NUM; }
+
+ public:
+  // Constructors and Destructor
+  FlatHashMap () { allocate (INIT_CAPACITY); } // Default
+
+  /**
+   * Main Constructor
+   * Gets a vector of KeyT type and a vector of ValueT type and inserts the
+   * key-value pairs by order, later values overwrite earlier ones
+   * @param keyVec
+   * @param valVec
+   */
+  FlatHashMap (const std::vector<KeyT> &keyVec,
+               const std::vector<ValueT> &valVec);
+
+  /**
+   * Copy Constructor
+   * @param other
+   */
+  FlatHashMap (const FlatHashMap<KeyT, ValueT> &other);
+
+  virtual ~FlatHashMap () { destroy (); }
+
+  /**
+   * Operator=
+   * @param other
+   * @return a deep copy of other
+   */
+  FlatHashMap &operator= (const FlatHashMap<KeyT, ValueT> &other);
+
+  // Getters and Checkers
+  int size () const { return _size; }
+  int capacity () const { return _capacity; }
+  double get_load_factor () const { return (double) _size / _capacity; }
+  bool contains_key (const KeyT &key) const
+  { return find_index (key, hash_key (key)) != -1; }
+  bool empty () const { return _size == INIT; }
+
+  // Operations
+
+  /**
+   * Insert Function
+   * Inserts a pair of key-value, if map does not contain key
+   * @param key
+   * @param value
+   * @return true upon success
+   */
+  bool insert (const KeyT &key, const ValueT &value);
+
+  /**
+   * Erase pair, leaving a tombstone only if a probe may pass through it
+   * @param key
+   * @return true upon success of operation
+   */
+  virtual bool erase (const KeyT &key);
+
+  /**
+   * Clear all pairs, capacity stays the same
+   */
+  void clear ();
+
+  // Operators
+
+  /**
+   * At operator
+   * Raises exceptions if does not exist
+   * @param key
+   * @return ValueT if exists
+   */
+  ValueT &at (const KeyT &key);
+  const ValueT &at (const KeyT &key) const; // const version
+
+  /**
+   * Operator []
+   * Inserts a default ValueT if key does not exist
+   * @param key
+   * @return ValueT
+   */
+  ValueT &operator[] (const KeyT &key);
+  const ValueT &operator[] (const KeyT &key) const { return at (key); }
+
+  /**
+   * Operator ==
+   * @param other
+   * @return true if both maps hold the same pairs
+   */
+  bool operator== (const FlatHashMap &other) const;
+  bool operator!= (const FlatHashMap &other) const
+  { return !(operator== (other)); }
+
+  // Begin & End functions
+  class ConstIterator;
+  using const_iterator = ConstIterator;
+  const_iterator begin () const { return ConstIterator (*this, 0); }
+  const_iterator cbegin () const { return begin (); }
+  const_iterator end () const { return ConstIterator (*this, _capacity); }
+  const_iterator cend () const { return end (); }
+
+  // Nested class - ConstIterator
+  class ConstIterator {
+    // Privates
+    int slot_ind; // Index of a full slot, or capacity at the end
+    const FlatHashMap<KeyT, ValueT> *flat_map; // map to iterate on
+
+    /**
+     * Move slot_ind forward to the first full slot at or after it
+     */
+    void skip_free ()
+    {
+      while (slot_ind < flat_map->_capacity
+             && flat_map->ctrl[slot_ind] < 0)
+        {
+          slot_ind++;
+        }
+    }
+
+   public:
+    // Iterator traits:
+    typedef std::pair<KeyT, ValueT> value_type;
+    typedef const value_type &reference;
+    typedef const value_type *pointer;
+    typedef std::ptrdiff_t difference_type;
+    typedef std::forward_iterator_tag iterator_category;
+
+    /**
+     * Constructor
+     * @param flat_map
+     * @param start first slot index to consider
+     */
+    ConstIterator (const FlatHashMap<KeyT, ValueT> &flat_map, int start)
+        : slot_ind (start), flat_map (&flat_map)
+    { skip_free (); }
+
+    ConstIterator &operator++ ()
+    {
+      slot_ind++;
+      skip_free ();
+      return *this;
+    }
+
+    ConstIterator operator++ (int)
+    {
+      ConstIterator tmp_it (*this);
+      ++(*this);
+      return tmp_it;
+    }
+
+    bool operator== (const ConstIterator &rhs) const
+    { return flat_map == rhs.flat_map && slot_ind == rhs.slot_ind; }
+
+    bool operator!= (const ConstIterator &rhs) const
+    { return !(*this == rhs); }
+
+    // Access operators
+    reference operator* () const { return flat_map->slots[slot_ind]; }
+    pointer operator-> () const { return &(operator* ()); }
+  };
+};
+
+template<class KeyT, class ValueT>
+unsigned FlatHashMap<KeyT, ValueT>:: match_tag (const int8_t *group,
+                                                 int8_t tag)
+{
+#ifdef __SSE2__
+  __m128i ctrl_bytes = _mm_loadu_si128 ((const __m128i *) group);
+  return (unsigned) _mm_movemask_epi8
+      (_mm_cmpeq_epi8 (_mm_set1_epi8 (tag), ctrl_bytes));
+#else
+  unsigned mask = 0;
+  for (int i = 0; i < GROUP_WIDTH; i++)
+    {
+      if (group[i] == tag)
+        {
+          mask |= 1u << i;
+        }
+    }
+  return mask;
+#endif
+}
+
+template<class KeyT, class ValueT>
+unsigned FlatHashMap<KeyT, ValueT>:: match_empty (const int8_t *group)
+{
+  return match_tag (group, CTRL_EMPTY);
+}
+
+template<class KeyT, class ValueT>
+unsigned FlatHashMap<KeyT, ValueT>:: match_empty_or_deleted
+    (const int8_t *group)
+{
+#ifdef __SSE2__
+  // Empty and deleted are the only tags with the sign bit set
+  return (unsigned) _mm_movemask_epi8
+      (_mm_loadu_si128 ((const __m128i *) group));
+#else
+  unsigned mask = 0;
+  for (int i = 0; i < GROUP_WIDTH; i++)
+    {
+      if (group[i] < 0)
+        {
+          mask |= 1u << i;
+        }
+    }
+  return mask;
+#endif
+}
+
+template<class KeyT, class ValueT>
+size_t FlatHashMap<KeyT, ValueT>:: hash_key (const KeyT &key)
+{
+  return hash_mix (std::hash<KeyT>{} (key));
+}
+
+template<class KeyT, class ValueT>
+int FlatHashMap<KeyT, ValueT>:: find_index (const KeyT &key, size_t hash)
+    const
+{
+  const int8_t tag = (int8_t) (hash & H2_MASK);
+  const size_t group_mask = (size_t) (_capacity / GROUP_WIDTH) - 1;
+  size_t group = (hash >> H2_BITS) & group_mask;
+  // Triangular probing over groups visits every group once
+  for (size_t step = 1; step <= group_mask + 1; step++)
+    {
+      const int8_t *group_ctrl = ctrl + group * GROUP_WIDTH;
+      unsigned match = match_tag (group_ctrl, tag);
+      while (match)
+        {
+          int ind = (int) (group * GROUP_WIDTH) + __builtin_ctz (match);
+          if (slots[ind].first == key)
+            {
+              return ind;
+            }
+          match &= match - 1;
+        }
+      if (match_empty (group_ctrl))
+        {
+          return -1;
+        }
+      group = (group + step) & group_mask;
+    }
+  return -1;
+}
+
+template<class KeyT, class ValueT>
+int FlatHashMap<KeyT, ValueT>:: prepare_insert (size_t hash)
+{
+  const size_t group_mask = (size_t) (_capacity / GROUP_WIDTH) - 1;
+  size_t group = (hash >> H2_BITS) & group_mask;
+  for (size_t step = 1;; step++)
+    {
+      unsigned free = match_empty_or_deleted (ctrl + group * GROUP_WIDTH);
+      if (free)
+        {
+          int ind = (int) (group * GROUP_WIDTH) + __builtin_ctz (free);
+          if (ctrl[ind] == CTRL_DELETED)
+            {
+              return ind; // Reusing a tombstone costs no growth
+            }
+          if (_growth_left > 0)
+            {
+              _growth_left--;
+              return ind;
+            }
+          // Out of empty slots: drop tombstones if they are the cause,
+          // otherwise grow
+          rehash (_size < max_load () / MULT ? _capacity : _capacity * MULT);
+          return prepare_insert (hash);
+        }
+      group = (group + step) & group_mask;
+    }
+}
+
+template<class KeyT, class ValueT>
+void FlatHashMap<KeyT, ValueT>:: allocate (int capacity)
+{
+  _capacity = capacity;
+  slots = static_cast<slot_type *>
+  (::operator new (sizeof (slot_type) * (size_t) capacity));
+  ctrl = new int8_t[capacity];
+  std::memset (ctrl, CTRL_EMPTY, (size_t) capacity);
+  _size = INIT;
+  _growth_left = max_load ();
+}
+
+template<class KeyT, class ValueT>
+void FlatHashMap<KeyT, ValueT>:: destroy ()
+{
+  for (int i = 0; i < _capacity; i++)
+    {
+      if (ctrl[i] >= 0)
+        {
+          slots[i].~slot_type ();
+        }
+    }
+  ::operator delete (slots);
+  delete[] ctrl;
+}
+
+template<class KeyT, class ValueT>
+void FlatHashMap<KeyT, ValueT>:: rehash (int new_capacity)
+{
+  slot_type *old_slots = slots;
+  int8_t *old_ctrl = ctrl;
+  int old_capacity = _capacity, old_size = _size;
+  allocate (new_capacity);
+  for (int i = 0; i < old_capacity; i++)
+    {
+      if (old_ctrl[i] < 0)
+        {
+          continue;
+        }
+      size_t hash = hash_key (old_slots[i].first);
+      int ind = prepare_insert (hash);
+      new (slots + ind) slot_type (std::move (old_slots[i]));
+      set_ctrl (ind, (int8_t) (hash & H2_MASK));
+      old_slots[i].~slot_type ();
+    }
+  _size = old_size;
+  ::operator delete (old_slots);
+  delete[] old_ctrl;
+}
+
+template<class KeyT, class ValueT>
+FlatHashMap<KeyT, ValueT>:: FlatHashMap (const std::vector<KeyT> &keyVec,
+                                         const std::vector<ValueT> &valVec)
+{
+  if (keyVec.size () != valVec.size ())
+    {
+      throw std::length_error (VECTOR_LENGTH);
+    }
+  int capacity = INIT_CAPACITY;
+  while (capacity / FLAT_MAX_LOAD_DEN * FLAT_MAX_LOAD_NUM
+         < (int) keyVec.size ())
+    {
+      capacity *= MULT;
+    }
+  allocate (capacity);
+  for (int i = 0; i < (int) keyVec.size (); i++)
+    {
+      (*this)[keyVec[i]] = valVec[i];
+    }
+}
+
+template<class KeyT, class ValueT>
+FlatHashMap<KeyT, ValueT>:: FlatHashMap (const FlatHashMap<KeyT, ValueT>
+                                         &other)
+{
+  allocate (other._capacity);
+  for (int i = 0; i < _capacity; i++)
+    {
+      if (other.ctrl[i] >= 0)
+        {
+          new (slots + i) slot_type (other.slots[i]);
+        }
+    }
+  // Same capacity and hash, so every pair keeps its slot and tag
+  std::memcpy (ctrl, other.ctrl, (size_t) _capacity);
+  _size = other._size;
+  _growth_left = other._growth_left;
+}
+
+template<class KeyT, class ValueT>
+FlatHashMap<KeyT, ValueT> &FlatHashMap<KeyT, ValueT>:: operator=
+    (const FlatHashMap<KeyT, ValueT> &other)
+{
+  if (this == &other)
+    {
+      return *this;
+    }
+  FlatHashMap<KeyT, ValueT> copy (other);
+  std::swap (slots, copy.slots);
+  std::swap (ctrl, copy.ctrl);
+  std::swap (_size, copy._size);
+  std::swap (_capacity, copy._capacity);
+  std::swap (_growth_left, copy._growth_left);
+  return *this;
+}
+
+template<class KeyT, class ValueT>
+bool FlatHashMap<KeyT, ValueT>:: insert (const KeyT &key, const ValueT &value)
+{
+  size_t hash = hash_key (key);
+  if (find_index (key, hash) != -1)
+    {
+      return false;
+    }
+  int ind = prepare_insert (hash);
+  new (slots + ind) slot_type (key, value);
+  set_ctrl (ind, (int8_t) (hash & H2_MASK));
+  _size++;
+  return true;
+}
+
+template<class KeyT, class ValueT>
+bool FlatHashMap<KeyT, ValueT>:: erase (const KeyT &key)
+{
+  int ind = find_index (key, hash_key (key));
+  if (ind == -1)
+    {
+      return false;
+    }
+  slots[ind].~slot_type ();
+  // A probe only ever continues past a group that had no empty slot, so if
+  // this group still has one, no probe can depend on this slot being taken
+  const int8_t *group_ctrl = ctrl + ind / GROUP_WIDTH * GROUP_WIDTH;
+  if (match_empty (group_ctrl))
+    {
+      set_ctrl (ind, CTRL_EMPTY);
+      _growth_left++;
+    }
+  else
+    {
+      set_ctrl (ind, CTRL_DELETED);
+    }
+  --_size;
+  return true;
+}
+
+template<class KeyT, class ValueT>
+void FlatHashMap<KeyT, ValueT>:: clear ()
+{
+  for (int i = 0; i < _capacity; i++)
+    {
+      if (ctrl[i] >= 0)
+        {
+          slots[i].~slot_type ();
+        }
+    }
+  std::memset (ctrl, CTRL_EMPTY, (size_t) _capacity);
+  _size = INIT;
+  _growth_left = max_load ();
+}
+
+template<class KeyT, class ValueT>
+ValueT &FlatHashMap<KeyT, ValueT>:: at (const KeyT &key)
+{
+  int ind = find_index (key, hash_key (key));
+  if (ind == -1)
+    {
+      throw std::invalid_argument (KEY_NOT_FOUND);
+    }
+  return slots[ind].second;
+}
+
+template<class KeyT, class ValueT>
+const ValueT &FlatHashMap<KeyT, ValueT>:: at (const KeyT &key) const
+{
+  int ind = find_index (key, hash_key (key));
+  if (ind == -1)
+    {
+      throw std::invalid_argument (KEY_NOT_FOUND);
+    }
+  return slots[ind].second;
+}
+
+template<class KeyT, class ValueT>
+ValueT &FlatHashMap<KeyT, ValueT>:: operator[] (const KeyT &key)
+{
+  size_t hash = hash_key (key);
+  int ind = find_index (key, hash);
+  if (ind != -1)
+    {
+      return slots[ind].second;
+    }
+  ind = prepare_insert (hash);
+  new (slots + ind) slot_type (key, ValueT ());
+  set_ctrl (ind, (int8_t) (hash & H2_MASK));
+  _size++;
+  return slots[ind].second;
+}
+
+template<class KeyT, class ValueT>
+bool FlatHashMap<KeyT, ValueT>:: operator== (const FlatHashMap &other) const
+{
+  if (_size != other._size)
+    {
+      return false;
+    }
+  for (const auto &it : other)
+    {
+      int ind = find_index (it.first, hash_key (it.first));
+      if (ind == -1 || slots[ind].second != it.second)
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+#endif //FLATHASHMAP_EX6
@@ -0,0 +1,501 @@
+#ifndef FROZENHASHMAP_EX6
+#define FROZENHASHMAP_EX6
+
+#include "HashMap.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#define FROZEN_BUCKET_KEYS 4
+#define FROZEN_SEED_MULT 0x9e3779b97f4a7c15ULL
+
+/**
+ * frozen_field trait
+ * How a FrozenHashMap keeps a key or value: as it is, or for a std::string
+ * in the arena, as an ArenaString view of its bytes
+ * @tparam T key or value type
+ * @tparam Arena whether T is a std::string kept in the arena
+ */
+template<class T, bool Arena = false>
+struct frozen_field {
+  typedef T type;
+  static size_t arena_bytes (const T &) { return INIT; }
+  static type store (T &&item, char *&) { return std::move (item); }
+  static const T &restore (const type &field) { return field; }
+  static void rebase (type &, const char *, const char *) {}
+};
+
+template<>
+struct frozen_field<std::string, true> {
+  typedef ArenaString type;
+  static size_t arena_bytes (const std::string &item) { return item.size (); }
+
+  /**
+   * Copy the bytes of item to cur and advance it
+   * @return view of the copy
+   */
+  static type store (std::string &&item, char *&cur)
+  {
+    if (item.empty ())
+      {
+        return type (cur, INIT);
+      }
+    std::memcpy (cur, item.data (), item.size ());
+    cur += item.size ();
+    return type (cur - item.size (), item.size ());
+  }
+  static std::string restore (const type &field)
+  { return std::string (field.data (), field.size ()); }
+
+  /**
+   * Point field at the same bytes of a copy of its arena
+   */
+  static void rebase (type &field, const char *from, const char *to)
+  { field = type (to + (field.data () - from), field.size ()); }
+};
+
+/**
+ * frozen_arena_key trait
+ * Whether std::string keys can be kept in the arena: KeyEqual must compare
+ * an ArenaString with a std::string (std::equal_to<> does)
+ */
+template<class KeyEqual, class = void>
+struct frozen_arena_key : std::false_type {};
+
+template<class KeyEqual>
+struct frozen_arena_key<KeyEqual, decltype (
+    (void) std::declval<const KeyEqual &> () (
+        std::declval<const ArenaString &> (),
+        std::declval<const std::string &> ()), void ())> : std::true_type {};
+
+/**
+ * FrozenHashMap class
+ * Immutable map built once at run time, usually by HashMap::freeze (), for
+ * maps that are only read after startup. The pairs sit in one contiguous
+ * vector with no empty slots, indexed by a minimal perfect hash (hash and
+ * displace): the keys are hashed into one bucket per FROZEN_BUCKET_KEYS
+ * keys, and every bucket keeps the 4-byte seed that sends all its keys to
+ * distinct slots. A lookup calls the hash policy once, reads the seed (a
+ * small, cache-friendly array) and compares the key of a single slot, so it
+ * misses the cache about once. Memory is the pairs plus a byte a key.
+ * std::string keys and values are not kept as strings, each in a heap
+ * block of its own: their bytes are copied into one arena, the key of a
+ * pair right before its value, and the pair holds ArenaString views of
+ * them (see frozen_field). A hit then reads the slot and one run of arena
+ * bytes. Keys stay strings if KeyEqual cannot compare the views (see
+ * frozen_arena_key).
+ * Keys whose full hash equals that of an earlier key (the hash policy may
+ * collide, as for HashMap) cannot get a slot of their own: they follow the
+ * slots in the pairs vector, sorted by hash, and a lookup that misses its
+ * slot searches them only if there are any.
+ * @tparam KeyT
+ * @tparam ValueT
+ * @tparam Hash hash policy
+ * @tparam KeyEqual key equality policy
+ */
+template<class KeyT, class ValueT, class Hash, class KeyEqual>
+class FrozenHashMap {
+
+  // Private Members
+  typedef std::pair<KeyT, ValueT> pair_type;
+  typedef frozen_field<KeyT, std::is_same<KeyT, std::string>::value
+      && frozen_arena_key<KeyEqual>::value> key_field;
+  typedef frozen_field<ValueT, std::is_same<ValueT, std::string>::value>
+      value_field;
+
+ public:
+  // Types of the pairs: KeyT and ValueT, or ArenaString (see frozen_field)
+  typedef typename key_field::type stored_key;
+  typedef typename value_field::type stored_value;
+  typedef std::pair<stored_key, stored_value> stored_pair;
+
+ private:
+  std::vector<stored_pair> pairs; // Pair of every slot, then the overflow
+  std::vector<char> arena; // Bytes of the arena keys and values, in order
+  // Hash of every overflow pair, pairs past the slots, sorted
+  std::vector<size_t> overflow_hashes;
+  // Seed of every bucket: > 0 a seed of the hash, < 0 slot -(seed + 1)
+  std::vector<int32_t> seeds;
+  uint64_t _salt = INIT; // Seed of the bucket hash, changed on a retry
+  Hash _hasher;
+  KeyEqual _key_equal;
+
+  // Private helper functions
+
+  size_t full_hash (const KeyT &key) const { return hash_mix (_hasher (key)); }
+
+  size_t bucket_of (size_t hash) const
+  { return hash_mix (hash ^ _salt) % seeds.size (); }
+
+  static size_t slot_of (size_t hash, int32_t seed, size_t n)
+  {
+    return seed < INIT ? (size_t) (-(int64_t) seed - 1)
+                       : hash_mix (hash + seed * FROZEN_SEED_MULT) % n;
+  }
+
+  /**
+   * Find the slot of key
+   * @return index of slot, or -1 if key does not exist
+   */
+  int find_slot (const KeyT &key) const;
+
+  /**
+   * Number of slots, the pairs indexed by the perfect hash
+   */
+  size_t slot_count () const { return pairs.size () - overflow_hashes.size (); }
+
+  /**
+   * Build the perfect hash of items, moving them into pairs and arena
+   * @param items pairs with distinct keys
+   */
+  void build (std::vector<pair_type> &&items);
+
+  /**
+   * Point the arena views of pairs, copied from a map whose arena starts
+   * at from, into arena
+   */
+  void rebase (const char *from);
+
+  /**
+   * Try to place the items of every bucket with the current salt
+   * @param hashes full hash of every item, all distinct
+   * @param slots filled with the slot of every item
+   * @return false if some bucket found no seed, then the salt must change
+   */
+  bool place (const std::vector<size_t> &hashes, std::vector<int> &slots);
+
+ public:
+  // Constructors
+  FrozenHashMap () : seeds (HASH_HELP, INIT) {} // Default, empty
+
+  /**
+   * Map Constructor
+   * Freezes the pairs of map, see HashMap::freeze ()
+   * @tparam Map a map with distinct keys and forward iteration over pairs
+   */
+  template<class Map>
+  explicit FrozenHashMap (const Map &map, const Hash &hasher = Hash (),
+                          const KeyEqual &key_equal = KeyEqual ())
+      : _hasher (hasher), _key_equal (key_equal)
+  { build (std::vector<pair_type> (map.begin (), map.end ())); }
+
+  /**
+   * Main Constructor
+   * Gets a vector of KeyT type and a vector of ValueT type; later values
+   * overwrite earlier ones, as for HashMap
+   * @param keyVec
+   * @param valVec
+   */
+  FrozenHashMap (const std::vector<KeyT> &keyVec,
+                 const std::vector<ValueT> &valVec)
+      : FrozenHashMap (HashMap<KeyT, ValueT, Hash, KeyEqual> (keyVec, valVec))
+  {}
+
+  // Copy and Move, a copy gets its own arena
+  FrozenHashMap (const FrozenHashMap &other)
+      : pairs (other.pairs), arena (other.arena),
+        overflow_hashes (other.overflow_hashes), seeds (other.seeds),
+        _salt (other._salt), _hasher (other._hasher),
+        _key_equal (other._key_equal)
+  { rebase (other.arena.data ()); }
+  FrozenHashMap (FrozenHashMap &&other) = default;
+  FrozenHashMap &operator= (const FrozenHashMap &other)
+  {
+    if (this != &other)
+      {
+        *this = FrozenHashMap (other);
+      }
+    return *this;
+  }
+  FrozenHashMap &operator= (FrozenHashMap &&other) = default;
+
+  // Getters and Checkers
+  int size () const { return (int) pairs.size (); }
+  bool empty () const { return pairs.empty (); }
+  bool contains_key (const KeyT &key) const { return find_slot (key) != -1; }
+
+  /**
+   * Bytes of memory held by the map, including the arena, besides the
+   * memory owned by keys and values kept as they are
+   */
+  size_t memory_usage () const
+  {
+    return sizeof (*this) + pairs.capacity () * sizeof (stored_pair)
+           + arena.capacity () + seeds.capacity () * sizeof (int32_t)
+           + overflow_hashes.capacity () * sizeof (size_t);
+  }
+
+  // Operators
+
+  /**
+   * At operator
+   * Raises exceptions if does not exist
+   * @param key
+   * @return ValueT (ArenaString for a std::string) if exists
+   */
+  const stored_value &at (const KeyT &key) const;
+  const stored_value &operator[] (const KeyT &key) const { return at (key); }
+
+  /**
+   * Try Get Function
+   * @param key
+   * @return pointer to the value of key, or nullptr if key does not exist
+   */
+  const stored_value *try_get (const KeyT &key) const
+  {
+    int slot = find_slot (key);
+    return slot == -1 ? nullptr : &pairs[slot].second;
+  }
+
+  /**
+   * Operator ==
+   * @param other
+   * @return true if both maps hold the same pairs
+   */
+  bool operator== (const FrozenHashMap &other) const;
+  bool operator!= (const FrozenHashMap &other) const
+  { return !(operator== (other)); }
+
+  // Begin & End functions, a plain scan of the contiguous pairs
+  typedef typename std::vector<stored_pair>::const_iterator const_iterator;
+  const_iterator begin () const { return pairs.begin (); }
+  const_iterator cbegin () const { return begin (); }
+  const_iterator end () const { return pairs.end (); }
+  const_iterator cend () const { return end (); }
+};
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual>
+int FrozenHashMap<KeyT, ValueT, Hash, KeyEqual>:: find_slot
+    (const KeyT &key) const
+{
+  if (pairs.empty ())
+    {
+      return -1;
+    }
+  size_t hash = full_hash (key);
+  size_t slot = slot_of (hash, seeds[bucket_of (hash)], slot_count ());
+  if (_key_equal (pairs[slot].first, key))
+    {
+      return (int) slot;
+    }
+  auto range = std::equal_range (overflow_hashes.begin (),
+                                 overflow_hashes.end (), hash);
+  for (auto it = range.first; it != range.second; ++it)
+    {
+      size_t ind = slot_count () + (it - overflow_hashes.begin ());
+      if (_key_equal (pairs[ind].first, key))
+        {
+          return (int) ind;
+        }
+    }
+  return -1;
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual>
+void FrozenHashMap<KeyT, ValueT, Hash, KeyEqual>:: build
+    (std::vector<pair_type> &&items)
+{
+  // The first item of every hash gets a slot, the other items of the same
+  // hash (by index, so the result does not depend on the sort) overflow
+  std::vector<std::pair<size_t, int>> by_hash (items.size ());
+  for (size_t i = 0; i < items.size (); i++)
+    {
+      by_hash[i] = {full_hash (items[i].first), (int) i};
+    }
+  std::sort (by_hash.begin (), by_hash.end ());
+  std::vector<size_t> hashes;
+  std::vector<int> slot_items, overflow_items;
+  overflow_hashes.clear ();
+  for (size_t i = 0; i < by_hash.size (); i++)
+    {
+      if (i > INIT && by_hash[i].first == by_hash[i - 1].first)
+        {
+          overflow_hashes.push_back (by_hash[i].first);
+          overflow_items.push_back (by_hash[i].second);
+          continue;
+        }
+      hashes.push_back (by_hash[i].first);
+      slot_items.push_back (by_hash[i].second);
+    }
+
+  int n = (int) hashes.size ();
+  seeds.assign (std::max (HASH_HELP, n / FROZEN_BUCKET_KEYS), INIT);
+  std::vector<int> slots (n);
+  while (!place (hashes, slots))
+    {
+      _salt++;
+    }
+  // Move every item to its slot, then the overflow in hash order
+  std::vector<int> order (n);
+  for (int i = 0; i < n; i++)
+    {
+      order[slots[i]] = slot_items[i];
+    }
+  order.insert (order.end (), overflow_items.begin (), overflow_items.end ());
+  size_t arena_size = INIT;
+  for (const pair_type &item : items)
+    {
+      arena_size += key_field::arena_bytes (item.first)
+                    + value_field::arena_bytes (item.second);
+    }
+  arena.assign (arena_size, INIT);
+  char *cur = arena.data ();
+  pairs.clear ();
+  pairs.reserve (items.size ());
+  for (int i : order)
+    {
+      // The key bytes first, so the value bytes follow them
+      stored_key key = key_field::store (std::move (items[i].first), cur);
+      pairs.emplace_back (std::move (key), value_field::store
+          (std::move (items[i].second), cur));
+    }
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual>
+void FrozenHashMap<KeyT, ValueT, Hash, KeyEqual>:: rebase (const char *from)
+{
+  for (stored_pair &pair : pairs)
+    {
+      key_field::rebase (pair.first, from, arena.data ());
+      value_field::rebase (pair.second, from, arena.data ());
+    }
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual>
+bool FrozenHashMap<KeyT, ValueT, Hash, KeyEqual>:: place
+    (const std::vector<size_t> &hashes, std::vector<int> &slots)
+{
+  int n = (int) hashes.size (), num_buckets = (int) seeds.size ();
+  // members[start[b] ... start[b + 1]) are the items of bucket b
+  std::vector<int> bucket (n), start (num_buckets + 1, INIT);
+  for (int i = 0; i < n; i++)
+    {
+      bucket[i] = (int) bucket_of (hashes[i]);
+      start[bucket[i] + 1]++;
+    }
+  int largest = INIT;
+  for (int b = 0; b < num_buckets; b++)
+    {
+      largest = std::max (largest, start[b + 1]);
+      start[b + 1] += start[b];
+    }
+  std::vector<int> members (n), filled (num_buckets, INIT);
+  for (int i = 0; i < n; i++)
+    {
+      members[start[bucket[i]] + filled[bucket[i]]++] = i;
+    }
+  // Buckets by decreasing size: the largest are placed while most slots
+  // are free, the single keys just take the slots left over
+  std::vector<int> by_size (num_buckets), size_start (largest + 2, INIT);
+  for (int b = 0; b < num_buckets; b++)
+    {
+      size_start[largest - filled[b] + 1]++;
+    }
+  for (int c = 0; c <= largest; c++)
+    {
+      size_start[c + 1] += size_start[c];
+    }
+  for (int b = 0; b < num_buckets; b++)
+    {
+      by_size[size_start[largest - filled[b]]++] = b;
+    }
+
+  std::vector<bool> taken (n, false);
+  int free_slot = INIT;
+  for (int b : by_size)
+    {
+      const int *first = members.data () + start[b];
+      int count = filled[b];
+      if (count == 1)
+        {
+          while (taken[free_slot])
+            {
+              free_slot++;
+            }
+          seeds[b] = -free_slot - 1;
+          slots[first[0]] = free_slot;
+          taken[free_slot] = true;
+          continue;
+        }
+      int32_t seed = HASH_HELP;
+      for (;; seed++)
+        {
+          if (seed > FROZEN_MAX_SEED)
+            {
+              return false;
+            }
+          int j = 0;
+          for (; j < count; j++)
+            {
+              int slot = (int) slot_of (hashes[first[j]], seed, n);
+              bool clash = taken[slot];
+              for (int k = 0; k < j && !clash; k++)
+                {
+                  clash = slots[first[k]] == slot;
+                }
+              if (clash)
+                {
+                  break;
+                }
+              slots[first[j]] = slot;
+            }
+          if (j == count)
+            {
+              break;
+            }
+        }
+      seeds[b] = seed;
+      for (int j = 0; j < count; j++)
+        {
+          taken[slots[first[j]]] = true;
+        }
+    }
+  return true;
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual>
+const typename FrozenHashMap<KeyT, ValueT, Hash, KeyEqual>::stored_value &
+FrozenHashMap<KeyT, ValueT, Hash, KeyEqual>:: at (const KeyT &key) const
+{
+  int slot = find_slot (key);
+  if (slot == -1)
+    {
+      throw std::invalid_argument (KEY_NOT_FOUND);
+    }
+  return pairs[slot].second;
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual>
+bool FrozenHashMap<KeyT, ValueT, Hash, KeyEqual>:: operator==
+    (const FrozenHashMap &other) const
+{
+  if (size () != other.size ())
+    {
+      return false;
+    }
+  for (const auto &it : other)
+    {
+      const stored_value *value = try_get (key_field::restore (it.first));
+      if (!value || *value != it.second)
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+FrozenHashMap<KeyT, ValueT, Hash, KeyEqual>
+HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: freeze () const
+{
+  return FrozenHashMap<KeyT, ValueT, Hash, KeyEqual> (*this, _hasher,
+                                                      _key_equal);
+}
+
+#endif //FROZENHASHMAP_EX6
@@ -0,0 +1,321 @@
+#ifndef FROZENMAP_EX6
+#define FROZENMAP_EX6
+
+#include "HashMap.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+/**
+ * frozen_hash policy
+ * Seeded hash of a key that can run at compile time: integral keys and
+ * (C++17) std::string_view. A FrozenMap tries seeds until the keys of a bucket
+ * land in free slots, so every seed must give an independent hash.
+ */
+template<class KeyT, class = void>
+struct frozen_hash;
+
+template<class KeyT>
+struct frozen_hash<KeyT, std::enable_if_t<std::is_integral<KeyT>::value>> {
+  constexpr size_t operator() (KeyT key, uint64_t seed) const
+  { return hash_mix ((uint64_t) key ^ hash_mix (seed + FINGERPRINT_SEED)); }
+};
+
+#if __cplusplus >= 201703L
+template<>
+struct frozen_hash<std::string_view> {
+  constexpr size_t operator() (std::string_view key, uint64_t seed) const
+  {
+    // FNV-1a, whose state starts from the seed, then mixed
+    uint64_t h = FNV_OFFSET ^ hash_mix (seed + FINGERPRINT_SEED);
+    for (char c : key)
+      {
+        h = (h ^ (unsigned char) c) * FNV_PRIME;
+      }
+    return hash_mix (h);
+  }
+};
+#endif
+
+/**
+ * frozen_array
+ * Fixed array whose elements can be written in a constant expression,
+ * which std::array allows only from C++17
+ */
+template<class T, size_t N>
+struct frozen_array {
+  T data[N];
+  constexpr T &operator[] (size_t i) { return data[i]; }
+  constexpr const T &operator[] (size_t i) const { return data[i]; }
+};
+
+/**
+ * FrozenMap class
+ * Immutable map of a fixed key set, built at compile time with a minimal
+ * perfect hash (hash and displace): the N keys are first hashed into N
+ * buckets, then, from the largest bucket down, every bucket gets the first
+ * seed that sends all its keys to free slots of the N slots (a bucket of
+ * one key takes a free slot directly). A lookup is one hash for the
+ * bucket, one for the slot and one key compare; there are no collisions
+ * and no empty slots.
+ * constexpr auto keywords = make_frozen_map<std::string_view, int>
+ *     ({{"GET", 1}, {"PUT", 2}, {"POST", 3}});
+ * static_assert (keywords.at ("PUT") == 2, "");
+ * @tparam KeyT integral type, or (C++17) std::string_view
+ * @tparam ValueT literal type, default constructible
+ * @tparam N number of keys
+ */
+template<class KeyT, class ValueT, size_t N>
+class FrozenMap {
+  static_assert (N > INIT, "FrozenMap needs at least one key");
+
+  // Private Members
+  frozen_array<KeyT, N> keys {}; // Key of every slot
+  frozen_array<ValueT, N> values {}; // Value of every slot
+  // Seed of every bucket: > 0 a seed of the hash, < 0 slot -(seed + 1)
+  frozen_array<int64_t, N> seeds {};
+
+  static constexpr size_t bucket_of (const KeyT &key)
+  { return frozen_hash<KeyT> {} (key, INIT) % N; }
+
+  static constexpr size_t slot_of (const KeyT &key, int64_t seed)
+  {
+    return seed < INIT ? (size_t) (-seed - 1)
+                       : frozen_hash<KeyT> {} (key, (uint64_t) seed) % N;
+  }
+
+  /**
+   * Find the slot of key
+   * @return index of slot, or -1 if key does not exist
+   */
+  constexpr int find_slot (const KeyT &key) const
+  {
+    size_t slot = slot_of (key, seeds[bucket_of (key)]);
+    return keys[slot] == key ? (int) slot : -1;
+  }
+
+ public:
+  /**
+   * Main Constructor
+   * Builds the perfect hash of items, at compile time in a constant
+   * expression. Duplicate keys (or, in theory, a bucket that no seed up to
+   * FROZEN_MAX_SEED can place) throw, which fails the compilation of a
+   * constant expression.
+   * @param items the key-value pairs
+   */
+  constexpr FrozenMap (const std::pair<KeyT, ValueT> (&items)[N]);
+
+  // Getters and Checkers
+  constexpr int size () const { return (int) N; }
+  constexpr bool empty () const { return false; }
+  constexpr bool contains_key (const KeyT &key) const
+  { return find_slot (key) != -1; }
+
+  // Operators
+
+  /**
+   * At operator
+   * Raises exceptions if does not exist
+   * @param key
+   * @return ValueT if exists
+   */
+  constexpr const ValueT &at (const KeyT &key) const
+  {
+    int slot = find_slot (key);
+    if (slot == -1)
+      {
+        throw std::invalid_argument (KEY_NOT_FOUND);
+      }
+    return values[slot];
+  }
+  constexpr const ValueT &operator[] (const KeyT &key) const
+  { return at (key); }
+
+  /**
+   * Try Get Function
+   * @param key
+   * @return pointer to the value of key, or nullptr if key does not exist
+   */
+  constexpr const ValueT *try_get (const KeyT &key) const
+  {
+    int slot = find_slot (key);
+    return slot == -1 ? nullptr : &values[slot];
+  }
+
+  // Begin & End functions, in slot order
+  class ConstIterator;
+  using const_iterator = ConstIterator;
+  constexpr const_iterator begin () const { return ConstIterator (*this, 0); }
+  constexpr const_iterator cbegin () const { return begin (); }
+  constexpr const_iterator end () const { return ConstIterator (*this, N); }
+  constexpr const_iterator cend () const { return end (); }
+
+  // Nested class - ConstIterator
+  // The pairs are split in two arrays, so it yields them by value
+  class ConstIterator {
+    // Privates
+    const FrozenMap *frozen_map; // map to iterate on
+    size_t slot; // Index of slot, N at the end
+
+   public:
+    // Iterator traits:
+    typedef std::pair<KeyT, ValueT> value_type;
+    typedef value_type reference;
+    typedef void pointer;
+    typedef std::ptrdiff_t difference_type;
+    typedef std::forward_iterator_tag iterator_category;
+
+    constexpr ConstIterator (const FrozenMap &frozen_map, size_t slot)
+        : frozen_map (&frozen_map), slot (slot) {}
+
+    constexpr ConstIterator &operator++ ()
+    {
+      slot++;
+      return *this;
+    }
+
+    constexpr ConstIterator operator++ (int)
+    {
+      ConstIterator tmp_it (*this);
+      ++(*this);
+      return tmp_it;
+    }
+
+    constexpr bool operator== (const ConstIterator &rhs) const
+    { return frozen_map == rhs.frozen_map && slot == rhs.slot; }
+
+    constexpr bool operator!= (const ConstIterator &rhs) const
+    { return !(*this == rhs); }
+
+    // Access operator
+    constexpr reference operator* () const
+    { return {frozen_map->keys[slot], frozen_map->values[slot]}; }
+  };
+};
+
+template<class KeyT, class ValueT, size_t N>
+constexpr FrozenMap<KeyT, ValueT, N>:: FrozenMap
+    (const std::pair<KeyT, ValueT> (&items)[N])
+{
+  // Group the items by bucket: members[start[b] ... start[b + 1]) are the
+  // indexes of the items of bucket b
+  frozen_array<size_t, N> bucket {};
+  frozen_array<size_t, N + 1> start {};
+  for (size_t i = 0; i < N; i++)
+    {
+      bucket[i] = bucket_of (items[i].first);
+      start[bucket[i] + 1]++;
+    }
+  for (size_t b = 0; b < N; b++)
+    {
+      start[b + 1] += start[b];
+    }
+  frozen_array<size_t, N> members {};
+  frozen_array<size_t, N> filled {};
+  size_t largest = INIT;
+  for (size_t i = 0; i < N; i++)
+    {
+      members[start[bucket[i]] + filled[bucket[i]]++] = i;
+      largest = std::max (largest, filled[bucket[i]]);
+    }
+
+  // Place the largest buckets first, while most slots are free
+  frozen_array<bool, N> taken {};
+  frozen_array<size_t, N> slots {};
+  for (size_t count = largest; count > 1; count--)
+    {
+      for (size_t b = 0; b < N; b++)
+        {
+          if (filled[b] != count)
+            {
+              continue;
+            }
+          const size_t *first = &members[start[b]];
+          for (size_t j = 0; j < count; j++)
+            {
+              for (size_t k = 0; k < j; k++)
+                {
+                  if (items[first[j]].first == items[first[k]].first)
+                    {
+                      throw std::invalid_argument (INVALID_MSG);
+                    }
+                }
+            }
+          int64_t seed = HASH_HELP;
+          for (;; seed++)
+            {
+              if (seed > FROZEN_MAX_SEED)
+                {
+                  throw std::invalid_argument (INVALID_MSG);
+                }
+              size_t j = 0;
+              for (; j < count; j++)
+                {
+                  slots[j] = slot_of (items[first[j]].first, seed);
+                  bool clash = taken[slots[j]];
+                  for (size_t k = 0; k < j && !clash; k++)
+                    {
+                      clash = slots[k] == slots[j];
+                    }
+                  if (clash)
+                    {
+                      break;
+                    }
+                }
+              if (j == count)
+                {
+                  break;
+                }
+            }
+          seeds[b] = seed;
+          for (size_t j = 0; j < count; j++)
+            {
+              taken[slots[j]] = true;
+              keys[slots[j]] = items[first[j]].first;
+              values[slots[j]] = items[first[j]].second;
+            }
+        }
+    }
+
+  // Buckets of one key take the remaining slots in order
+  size_t free_slot = INIT;
+  for (size_t b = 0; b < N; b++)
+    {
+      if (filled[b] != 1)
+        {
+          continue;
+        }
+      while (taken[free_slot])
+        {
+          free_slot++;
+        }
+      size_t i = members[start[b]];
+      seeds[b] = -(int64_t) free_slot - 1;
+      taken[free_slot] = true;
+      keys[free_slot] = items[i].first;
+      values[free_slot] = items[i].second;
+    }
+}
+
+/**
+ * Make Frozen Map Function
+ * @tparam KeyT
+ * @tparam ValueT
+ * @param items the key-value pairs, as a braced list of {key, value}
+ * @return FrozenMap of items
+ */
+template<class KeyT, class ValueT, size_t N>
+constexpr FrozenMap<KeyT, ValueT, N> make_frozen_map
+    (const std::pair<KeyT, ValueT> (&items)[N])
+{
+  return FrozenMap<KeyT, ValueT, N> (items);
+}
+
+#endif //FROZENMAP_EX6
@@ -0,0 +1,318 @@
+#ifndef HASHBUCKET_EX6
+#define HASHBUCKET_EX6
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include "KeySearch.hpp"
+
+/**
+ * Hint the CPU to start loading the cache line of address for a read
+ */
+inline void prefetch_read (const void *address)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch (address, 0, 1);
+#else
+  (void) address;
+#endif
+}
+
+/**
+ * HashBucket class
+ * One chain of a HashMap: the pairs whose keys map to the same bucket.
+ * This layout keeps only the pairs; the full hash of a pair is recomputed
+ * from its key whenever it is needed (rehash, migration).
+ * @tparam Pair std::pair<KeyT, ValueT>
+ * @tparam StoreHash whether the full hash of every pair is cached
+ */
+template<class Pair, bool StoreHash>
+class HashBucket {
+ protected:
+  std::vector<Pair> pairs;
+
+ public:
+  typedef typename std::vector<Pair>::iterator iterator;
+  typedef typename std::vector<Pair>::const_iterator const_iterator;
+
+  // Getters
+  int size () const { return (int) pairs.size (); }
+  bool empty () const { return pairs.empty (); }
+  Pair &operator[] (int ind) { return pairs[ind]; }
+  const Pair &operator[] (int ind) const { return pairs[ind]; }
+  iterator begin () { return pairs.begin (); }
+  iterator end () { return pairs.end (); }
+  const_iterator begin () const { return pairs.begin (); }
+  const_iterator end () const { return pairs.end (); }
+
+  /**
+   * Full hash of the pair at ind
+   * @param hash_fn computes the full hash of a key
+   */
+  template<class HashFn>
+  size_t hash_at (int ind, const HashFn &hash_fn) const
+  { return hash_fn (pairs[ind].first); }
+
+  /**
+   * Cached full hash of the pair at ind, or 0 if this layout caches none
+   * (find of such a layout does not read the hash)
+   */
+  size_t stored_hash (int) const { return 0; }
+
+  /**
+   * Index of the pair whose key equals key, or -1
+   * @param hash full hash of key
+   * @param key_equal key equality policy
+   */
+  template<class KeyT, class KeyEqual>
+  int find (const KeyT &key, size_t, const KeyEqual &key_equal) const
+  {
+    for (int i = 0; i < size (); i++)
+      {
+        if (key_equal (pairs[i].first, key))
+          {
+            return i;
+          }
+      }
+    return -1;
+  }
+
+  /**
+   * Prefetch the first pairs, the memory a key search starts reading
+   */
+  void prefetch () const
+  {
+    if (!pairs.empty ())
+      {
+        prefetch_read (pairs.data ());
+      }
+  }
+
+  // Operations
+  template<class... Args>
+  void emplace_back (size_t, Args &&... args)
+  { pairs.emplace_back (std::forward<Args> (args)...); }
+  void erase (int ind) { pairs.erase (pairs.begin () + ind); }
+  /**
+   * Erase by moving the last pair into ind: O(1), changes the order
+   */
+  void swap_erase (int ind)
+  {
+    if (ind != size () - 1)
+      {
+        pairs[ind] = std::move (pairs.back ());
+      }
+    pairs.pop_back ();
+  }
+  void clear () { pairs.clear (); }
+};
+
+/**
+ * HashBucket with cached hashes
+ * Keeps the full hash of every pair at the same index as the pair, so
+ * rehashing never calls the hash policy again and a candidate whose hash
+ * differs is rejected without comparing keys.
+ */
+template<class Pair>
+class HashBucket<Pair, true> : public HashBucket<Pair, false> {
+  std::vector<size_t> hashes;
+
+ public:
+  template<class HashFn>
+  size_t hash_at (int ind, const HashFn &) const { return hashes[ind]; }
+
+  size_t stored_hash (int ind) const { return hashes[ind]; }
+
+  template<class KeyT, class KeyEqual>
+  int find (const KeyT &key, size_t hash, const KeyEqual &key_equal) const
+  {
+    for (int i = 0; i < this->size (); i++)
+      {
+        if (hashes[i] == hash && key_equal (this->pairs[i].first, key))
+          {
+            return i;
+          }
+      }
+    return -1;
+  }
+
+  void prefetch () const
+  {
+    if (!hashes.empty ())
+      {
+        prefetch_read (hashes.data ());
+        prefetch_read (this->pairs.data ());
+      }
+  }
+
+  template<class... Args>
+  void emplace_back (size_t hash, Args &&... args)
+  {
+    this->pairs.emplace_back (std::forward<Args> (args)...);
+    hashes.push_back (hash);
+  }
+  void erase (int ind)
+  {
+    this->pairs.erase (this->pairs.begin () + ind);
+    hashes.erase (hashes.begin () + ind);
+  }
+  void swap_erase (int ind)
+  {
+    hashes[ind] = hashes.back ();
+    hashes.pop_back ();
+    HashBucket<Pair, false>::swap_erase (ind);
+  }
+  void clear ()
+  {
+    this->pairs.clear ();
+    hashes.clear ();
+  }
+};
+
+/**
+ * SplitKeyBucket class
+ * Structure-of-arrays layout: a HashBucket that also keeps a copy of every
+ * key in a contiguous array, at the same index as its pair. A search scans
+ * only that array, so it never pulls value bytes into cache; the pair (and
+ * so the value) is touched once, for the match. Integral keys compared with
+ * std::equal_to are scanned several per instruction (see find_key).
+ * Costs one extra copy of every key.
+ * @tparam Pair std::pair<KeyT, ValueT>
+ * @tparam StoreHash whether the full hash of every pair is cached too
+ */
+template<class Pair, bool StoreHash>
+class SplitKeyBucket : public HashBucket<Pair, StoreHash> {
+  typedef HashBucket<Pair, StoreHash> base;
+  typedef typename std::remove_const<typename Pair::first_type>::type key_type;
+  std::vector<key_type> keys;
+
+  template<class KeyT, class KeyEqual>
+  int find_keys (const KeyT &key, const KeyEqual &key_equal,
+                 std::false_type) const
+  {
+    for (int i = 0; i < (int) keys.size (); i++)
+      {
+        if (key_equal (keys[i], key))
+          {
+            return i;
+          }
+      }
+    return -1;
+  }
+
+  template<class KeyT, class KeyEqual>
+  int find_keys (const KeyT &key, const KeyEqual &, std::true_type) const
+  { return find_key (keys.data (), (int) keys.size (), (key_type) key); }
+
+ public:
+  template<class KeyT, class KeyEqual>
+  int find (const KeyT &key, size_t, const KeyEqual &key_equal) const
+  {
+    typedef std::integral_constant<bool,
+        std::is_integral<key_type>::value
+        && !std::is_same<key_type, bool>::value
+        && std::is_same<KeyEqual, std::equal_to<key_type>>::value> simd;
+    return find_keys (key, key_equal, simd ());
+  }
+
+  void prefetch () const
+  {
+    if (!keys.empty ())
+      {
+        prefetch_read (keys.data ());
+      }
+  }
+
+  template<class... Args>
+  void emplace_back (size_t hash, Args &&... args)
+  {
+    base::emplace_back (hash, std::forward<Args> (args)...);
+    try
+      {
+        keys.push_back (this->pairs.back ().first);
+      }
+    catch (...)
+      {
+        base::erase (base::size () - 1);
+        throw;
+      }
+  }
+  void erase (int ind)
+  {
+    base::erase (ind);
+    keys.erase (keys.begin () + ind);
+  }
+  void swap_erase (int ind)
+  {
+    keys[ind] = std::move (keys.back ());
+    keys.pop_back ();
+    base::swap_erase (ind);
+  }
+  void clear ()
+  {
+    base::clear ();
+    keys.clear ();
+  }
+};
+
+/**
+ * bucket_layout trait
+ * The bucket type of a HashMap
+ */
+template<class KeyT, class ValueT, bool StoreHash, bool SplitKeys>
+struct bucket_layout {
+  typedef std::pair<KeyT, ValueT> pair_type;
+  typedef typename std::conditional<SplitKeys,
+      SplitKeyBucket<pair_type, StoreHash>,
+      HashBucket<pair_type, StoreHash>>::type type;
+};
+
+#define BITS_PER_WORD 64
+
+/**
+ * BucketBitmap class
+ * One bit per bucket of a bucket array, set while the bucket holds a pair.
+ * A scan for the next non-empty bucket skips a whole word of empty buckets
+ * at a time, with count-trailing-zeros, instead of reading every bucket.
+ */
+class BucketBitmap {
+  std::vector<uint64_t> words;
+
+ public:
+  /**
+   * Size the bitmap for n buckets, all empty
+   */
+  void reset (int n)
+  { words.assign ((n + BITS_PER_WORD - 1) / BITS_PER_WORD, 0); }
+
+  void set (int ind)
+  { words[ind / BITS_PER_WORD] |= (uint64_t) 1 << (ind % BITS_PER_WORD); }
+  void unset (int ind)
+  { words[ind / BITS_PER_WORD] &= ~((uint64_t) 1 << (ind % BITS_PER_WORD)); }
+
+  /**
+   * @return first set index >= from, or -1 if there is none
+   */
+  int next (int from) const
+  {
+    size_t word = from / BITS_PER_WORD;
+    if (word >= words.size ())
+      {
+        return -1;
+      }
+    uint64_t bits = words[word] & (~(uint64_t) 0 << (from % BITS_PER_WORD));
+    while (!bits)
+      {
+        if (++word == words.size ())
+          {
+            return -1;
+          }
+        bits = words[word];
+      }
+    return (int) (word * BITS_PER_WORD) + __builtin_ctzll (bits);
+  }
+};
+
+#endif //HASHBUCKET_EX6
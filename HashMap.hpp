@@ -4,11 +4,24 @@
 #include <vector>
 #include <stdexcept>
 #include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <tuple>
+#include <utility>
+#include <string>
+#include <cstring>
+#include <climits>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+#include "HashBucket.hpp"
+#include "Parallel.hpp"
 
 #define INIT_CAPACITY 16
 #define INVALID_MSG "Error: Invalid argument"
 #define KEY_NOT_FOUND "Error: Key not found"
 #define VECTOR_LENGTH "Error: Vectors length is not the same"
+#define TOO_MANY_BUCKETS "Error: Capacity passes INT_MAX buckets"
 #define LOAD_FACTOR_MAX 0.75
 #define LOAD_FACTOR_MIN 0.25
 #define INIT 0
@@ -17,6 +30,228 @@
 #define MULT 2
 #define DIV 0.5
 #define HASH_HELP 1
+#define MIGRATE_STEP 8
+#define BULK_MIN_PER_THREAD 16384
+#define LOOKUP_BATCH 32
+#define FINGERPRINT_SEED 0x9e3779b97f4a7c15ULL
+#define FROZEN_MAX_SEED 65536 // Seeds a perfect hash bucket may try
+
+
+/**
+ * 64-bit finalizer (MurmurHash3 fmix64)
+ * Spreads every input bit over the whole output, so masking the low bits
+ * gives a uniform bucket even for identity hashes or keys with a common
+ * stride.
+ * @param h raw hash
+ * @return mixed hash
+ */
+constexpr size_t hash_mix (size_t h)
+{
+  uint64_t x = h;
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return (size_t) x;
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual>
+class FrozenHashMap; // FrozenHashMap.hpp
+
+/**
+ * hash_is_avalanching trait
+ * A Hash policy that already mixes its output well declares a member type
+ * is_avalanching; HashMap then skips hash_mix for it.
+ */
+template<class Hash, class = void>
+struct hash_is_avalanching : std::false_type {};
+
+template<class Hash>
+struct hash_is_avalanching<Hash, decltype ((void) sizeof (typename
+    Hash::is_avalanching), void ())> : std::true_type {};
+
+/**
+ * is_transparent trait
+ * A Hash or KeyEqual policy that takes other types than the key type, with
+ * the same results as for the equal key, declares a member type
+ * is_transparent (as std::equal_to<> does). When both policies of a HashMap
+ * do, its lookups take those types as they are, without building a key.
+ */
+template<class Policy, class = void>
+struct is_transparent : std::false_type {};
+
+// A pointer, as the member type is often void or incomplete
+template<class Policy>
+struct is_transparent<Policy, decltype ((void) (typename
+    Policy::is_transparent *) nullptr, void ())> : std::true_type {};
+
+/**
+ * is_lookup_key trait
+ * Whether a K can look up KeyT keys: Hash takes a const K &, and KeyEqual
+ * compares a stored const KeyT & with it
+ */
+template<class K, class KeyT, class Hash, class KeyEqual, class = void>
+struct is_lookup_key : std::false_type {};
+
+template<class K, class KeyT, class Hash, class KeyEqual>
+struct is_lookup_key<K, KeyT, Hash, KeyEqual, decltype (
+    (void) std::declval<const Hash &> () (std::declval<const K &> ()),
+    (void) std::declval<const KeyEqual &> () (std::declval<const KeyT &> (),
+                                              std::declval<const K &> ()),
+    void ())> : std::true_type {};
+
+/**
+ * Hash of n bytes, read 8 at a time
+ * @param s
+ * @param n
+ */
+inline size_t hash_bytes (const char *s, size_t n)
+{
+  uint64_t h = n * FINGERPRINT_SEED;
+  for (; n >= sizeof (uint64_t); s += sizeof (uint64_t),
+                                 n -= sizeof (uint64_t))
+    {
+      uint64_t word;
+      std::memcpy (&word, s, sizeof (uint64_t));
+      h = hash_mix (h ^ word);
+    }
+  uint64_t tail = INIT;
+  std::memcpy (&tail, s, n);
+  return (size_t) hash_mix (h ^ tail);
+}
+
+#if __cplusplus >= 201703L
+typedef std::string_view ArenaString;
+#else
+/**
+ * ArenaString class
+ * Read-only view of the bytes of a string, for keys and values kept in an
+ * arena (ArenaDictionary, FrozenHashMap) or read in place (load_tsv),
+ * std::string_view from C++17 on: the subset of std::string_view they need.
+ */
+class ArenaString {
+  const char *_data = nullptr;
+  size_t _size = INIT;
+
+ public:
+  // Constructors, a view of the bytes it is made from
+  ArenaString () = default;
+  ArenaString (const char *data, size_t size) : _data (data), _size (size) {}
+  ArenaString (const char *s) : ArenaString (s, std::strlen (s)) {}
+  ArenaString (const std::string &s) : ArenaString (s.data (), s.size ()) {}
+  explicit operator std::string () const { return std::string (_data, _size); }
+
+  const char *data () const { return _data; }
+  size_t size () const { return _size; }
+  bool empty () const { return _size == INIT; }
+  char operator[] (size_t pos) const { return _data[pos]; }
+
+  /**
+   * Substring Function
+   * Raises std::out_of_range if pos is past the end
+   * @return view of at most count bytes from pos
+   */
+  ArenaString substr (size_t pos, size_t count) const
+  {
+    if (pos > _size)
+      {
+        throw std::out_of_range (INVALID_MSG);
+      }
+    return {_data + pos, std::min (count, _size - pos)};
+  }
+
+  friend bool operator== (ArenaString lhs, ArenaString rhs)
+  {
+    return lhs._size == rhs._size
+           && (lhs._size == INIT
+               || std::memcmp (lhs._data, rhs._data, lhs._size) == 0);
+  }
+  friend bool operator!= (ArenaString lhs, ArenaString rhs)
+  { return !(lhs == rhs); }
+};
+#endif
+
+/**
+ * string_hash policy
+ * Transparent hash of std::string, const char * and ArenaString
+ * (std::string_view from C++17 on), equal for equal characters: the
+ * default hash of std::string keys (see hash_default). Before C++17 it is
+ * hash_bytes, so a const char * or an ArenaString is hashed in place.
+ */
+struct string_hash {
+  typedef void is_transparent;
+#if __cplusplus >= 201703L
+  size_t operator() (std::string_view s) const
+  { return std::hash<std::string_view> () (s); }
+#else
+  size_t operator() (const std::string &s) const
+  { return hash_bytes (s.data (), s.size ()); }
+  size_t operator() (const char *s) const
+  { return hash_bytes (s, std::char_traits<char>::length (s)); }
+  size_t operator() (ArenaString s) const
+  { return hash_bytes (s.data (), s.size ()); }
+#endif
+};
+
+/**
+ * hash_default and key_equal_default traits
+ * Default Hash and KeyEqual policies of a HashMap: std::hash and
+ * std::equal_to, except for std::string keys, which get the transparent
+ * string_hash and std::equal_to<>, so every HashMap<std::string, ValueT>
+ * looks keys up by const char * or std::string_view without building a
+ * string.
+ */
+template<class KeyT>
+struct hash_default {
+  typedef std::hash<KeyT> type;
+};
+
+template<>
+struct hash_default<std::string> {
+  typedef string_hash type;
+};
+
+template<class KeyT>
+struct key_equal_default {
+  typedef std::equal_to<KeyT> type;
+};
+
+template<>
+struct key_equal_default<std::string> {
+  typedef std::equal_to<> type;
+};
+
+/**
+ * store_hash_default trait
+ * Keys whose hashing and comparison are expensive (strings) cache their
+ * full hash in the map by default.
+ */
+template<class KeyT>
+struct store_hash_default : std::false_type {};
+
+template<class CharT, class Traits, class Alloc>
+struct store_hash_default<std::basic_string<CharT, Traits, Alloc>>
+    : std::true_type {};
+
+#if __cplusplus >= 201703L
+template<class CharT, class Traits>
+struct store_hash_default<std::basic_string_view<CharT, Traits>>
+    : std::true_type {};
+#endif
+
+#if __cplusplus < 201703L
+template<>
+struct hash_default<ArenaString> {
+  struct type {
+    size_t operator() (ArenaString s) const
+    { return hash_bytes (s.data (), s.size ()); }
+  };
+};
+
+template<>
+struct store_hash_default<ArenaString> : std::true_type {};
+#endif
 
 
 /**
@@ -24,15 +259,48 @@
  * Represents an unordered hash-map container of keyT-ValueT generic template
  * @tparam KeyT
  * @tparam ValueT
+ * @tparam Hash hash policy, its result is passed through hash_mix unless
+ * the policy declares is_avalanching
+ * @tparam KeyEqual key equality policy
+ * @tparam StoreHash cache the full hash next to every pair: resizes then
+ * redistribute without hashing, and lookups compare keys only on a hash
+ * match. On by default for string keys.
+ * @tparam SplitKeys structure-of-arrays layout: keep the keys of every
+ * bucket in their own contiguous array, so a key search reads no value
+ * bytes (see SplitKeyBucket); integral keys then get a vectorized search.
+ * Off by default: it costs a second array per bucket, and pays off only
+ * for buckets kept long by a high max load factor, or for large values.
  */
-template<class KeyT, class ValueT>
+template<class KeyT, class ValueT, class Hash = typename
+    hash_default<KeyT>::type,
+    class KeyEqual = typename key_equal_default<KeyT>::type,
+    bool StoreHash = store_hash_default<KeyT>::value,
+    bool SplitKeys = false>
 class HashMap {
 
   // Private Members
-  typedef std::vector<std::pair<KeyT, ValueT>> bucket;
+  typedef typename bucket_layout<KeyT, ValueT, StoreHash, SplitKeys>::type
+      bucket;
   bucket *buckets; // Array of buckets
   int _size=INIT; // Num of pairs in buckets array
   int _capacity = INIT_CAPACITY; // Num of buckets
+  Hash _hasher;
+  KeyEqual _key_equal;
+  // Incremental resize state: while old_buckets is set, old buckets below
+  // _migrate_pos were already moved into buckets, the rest are still live
+  bool _incremental = false;
+  bucket *old_buckets = nullptr;
+  int _old_capacity = INIT;
+  int _migrate_pos = INIT;
+  // Resize policy: grow above _max_load, shrink below _min_load, never below
+  // _min_capacity buckets
+  double _max_load = LOAD_FACTOR_MAX;
+  double _min_load = LOAD_FACTOR_MIN;
+  int _min_capacity = ERASE_LAST_INIT;
+  // Non-empty buckets of buckets and of old_buckets, for iteration
+  BucketBitmap occupied;
+  BucketBitmap old_occupied;
+  uint64_t _fingerprint = INIT; // Sum of key_print of every key
 
   // Private helper functions
 
@@ -45,11 +313,154 @@ class HashMap {
   int hash_func (const KeyT &key) const;
 
   /**
-   * Rehash func
+   * Full (mixed) hash of a key, computed once per operation
+   * @param key a KeyT, or a type the Hash policy takes (transparent lookup)
+   */
+  template<class K>
+  size_t full_hash (const K &key) const;
+  int bucket_of (size_t hash, int capacity) const
+  { return (int) (hash & (size_t) (capacity - HASH_HELP)); }
+
+  /**
+   * Bucket that holds the key of the given full hash, or would hold it if
+   * inserted now.
+   * During an incremental resize this is the old bucket of the key as long
+   * as that bucket was not migrated yet, so a lookup consults one bucket.
+   * @param hash full_hash of the key
+   */
+  bucket &locate_bucket (size_t hash);
+  const bucket &locate_bucket (size_t hash) const;
+
+  /**
+   * Iteration index (see bucket_at) of the bucket locate_bucket returns
+   */
+  int locate_index (size_t hash) const;
+
+  /**
+   * Index of key inside a bucket, or -1 if it is not there
+   */
+  template<class K>
+  int find_in (const bucket &key_bucket, const K &key, size_t hash) const;
+
+  /**
+   * Erase pair of key, see erase
+   */
+  template<class K>
+  bool erase_key (const K &key);
+
+  /**
+   * Full hash of the pair at ind of key_bucket (cached or recomputed)
+   */
+  size_t hash_at (const bucket &key_bucket, int ind) const;
+
+  /**
+   * Copy every pair of other into this map's (empty) buckets
+   */
+  void copy_pairs (const HashMap &other);
+
+  /**
+   * Move up to MIGRATE_STEP old buckets into the new array, releasing the
+   * old array once all of it is migrated. No-op when not resizing.
+   */
+  void migrate_step ();
+
+  /**
+   * Move every remaining old bucket into the new array
+   */
+  void finish_migration ();
+
+  /**
+   * Allocate INIT_CAPACITY buckets if this map was moved from
+   */
+  void ensure_buckets ();
+
+  /**
+   * Construct a pair in the bucket of hash, whose key must not be in the map
+   * yet. Resizes before placing the pair, so the reference stays valid.
+   * @return the new pair
+   */
+  template<class... Args>
+  std::pair<KeyT, ValueT> &emplace_new (size_t hash, Args &&... args);
+
+  /**
+   * Remove the pair at ind of the bucket at bucket_ind (an iteration index)
+   * and shrink if needed
+   * @param hash full hash of the pair's key
+   */
+  void erase_at (int bucket_ind, int ind, size_t hash);
+
+  /**
+   * Remove the pair at ind of the bucket at bucket_ind by moving the
+   * bucket's last pair into its place. Never resizes.
+   * @param hash full hash of the pair's key
+   */
+  void remove_at (int bucket_ind, int ind, size_t hash);
+
+  /**
+   * Contribution of a key of the given full hash to the fingerprint
+   */
+  static uint64_t key_print (size_t hash)
+  { return hash_mix (hash ^ FINGERPRINT_SEED); }
+
+  /**
+   * Whether two maps of this type surely hash (and compare) keys the same
+   * way: true for stateless policies
+   */
+  static bool same_policies ()
+  { return std::is_empty<Hash>::value && std::is_empty<KeyEqual>::value; }
+
+  /**
+   * operator== of two maps with the same capacity, not resizing and with
+   * stateless policies, so equal keys sit in equal bucket indexes: compares
+   * bucket against bucket, with no hashing and no probing of other buckets
+   */
+  bool equal_buckets (const HashMap &other) const;
+
+  /**
+   * Update the occupancy bit of the bucket at iteration index ind
+   */
+  void set_occupied (int ind, bool on)
+  {
+    BucketBitmap &bitmap = ind < _capacity ? occupied : old_occupied;
+    int bit = ind < _capacity ? ind : ind - _capacity;
+    if (on)
+      {
+        bitmap.set (bit);
+      }
+    else
+      {
+        bitmap.unset (bit);
+      }
+  }
+
+  /**
+   * Iteration index of the first non-empty bucket at or after ind, or
+   * bucket_total () if there is none
+   */
+  int next_occupied (int ind) const;
+
+  /**
+   * Recompute the occupancy bits of buckets from the buckets themselves
+   */
+  void rebuild_occupied ();
+
+  /**
+   * Bucket by iteration index: indexes [0, capacity) are the current array,
+   * indexes after it are the old array of an ongoing incremental resize
+   */
+  const bucket &bucket_at (int ind) const
+  { return ind < _capacity ? buckets[ind] : old_buckets[ind - _capacity]; }
+  bucket &bucket_at (int ind)
+  { return ind < _capacity ? buckets[ind] : old_buckets[ind - _capacity]; }
+  int bucket_total () const
+  { return old_buckets ? _capacity + _old_capacity : _capacity; }
+
+  /**
+   * Resize func
    * deletes current buckets array and allocates new array in new size.
-   * @param mult double to multiply by
+   * @param new_capacity power of two
    */
-  void rehash (double mult);
+  void resize (int new_capacity);
 
   /**
    * Update the capacity of the array - multiply by MULT or divide by DIV
@@ -58,44 +469,211 @@ class HashMap {
    */
   void update_capacity (bool is_grow);
 
+  /**
+   * Smallest power of two capacity, at least _min_capacity, that holds n
+   * pairs without passing the grow threshold
+   * @throw std::length_error if that capacity passes INT_MAX buckets
+   */
+  int capacity_for (long long n) const;
+
+  /**
+   * Doubles a capacity in long long so it cannot overflow
+   * @param capacity the capacity to double
+   * @return capacity * MULT
+   * @throw std::length_error if the result passes INT_MAX buckets
+   */
+  static int grown_capacity (long long capacity);
+
+  /**
+   * Capacity the map would reach if its pairs had been erased one by one:
+   * halved by DIV while under the shrink threshold, ERASE_LAST_INIT when
+   * empty, and never below _min_capacity nor above the current capacity
+   */
+  int shrunk_capacity () const;
+
+ public:
+  class ConstIterator;
+  class Iterator;
+
+ protected:
+  /**
+   * Enables a lookup by K: always for KeyT, for other types when both the
+   * Hash and KeyEqual policies are transparent and take a K (see
+   * is_transparent, is_lookup_key). Never for the map's own iterators, so
+   * erase (it) does not pick the key overload.
+   */
+  template<class K>
+  using key_arg = typename std::enable_if<std::is_same<K, KeyT>::value
+      || (is_transparent<Hash>::value && is_transparent<KeyEqual>::value
+          && is_lookup_key<K, KeyT, Hash, KeyEqual>::value
+          && !std::is_base_of<ConstIterator, K>::value)>::type;
+
+  /**
+   * Bulk assignment: the same result as (*this)[key_fn (i)] = value_fn (i)
+   * for i = 0 ... n - 1 in order (so the last value of a duplicate key wins),
+   * including the final capacity.
+   * The table is sized once up front. Large inputs are hashed in parallel,
+   * partitioned by destination bucket range and every partition is filled
+   * by its own thread, so no two threads touch the same bucket. Key and
+   * hash policies must be safe to call concurrently.
+   * @param key_fn callable as key_fn (int) -> const KeyT & (or a KeyT
+   * made on each call, or a transparent key that a KeyT is built from)
+   * @param value_fn callable as value_fn (int) -> ValueT
+   * @param num_threads most threads to use, fewer for small inputs
+   */
+  template<class KeyFn, class ValueFn>
+  void bulk_assign (int n, KeyFn key_fn, ValueFn value_fn,
+                    int num_threads = default_threads ());
+
+ private:
+
+  /**
+   * Batched lookup: for every LOOKUP_BATCH keys, hashes them all, prefetches
+   * their buckets, then the contents of the buckets, and only then compares
+   * keys, so the cache misses of a batch overlap instead of queueing.
+   * @param emit callable as emit (size_t i, const std::pair<KeyT, ValueT> *)
+   * with nullptr for a missing key
+   * @return number of keys found
+   */
+  template<class Emit>
+  size_t find_many (const KeyT *keys, size_t n, Emit emit) const;
+
 
  public:
   // Constructors and Destructor
   HashMap () : // Default
-  _size (0), _capacity (INIT_CAPACITY){buckets = new bucket[INIT_CAPACITY];}
+  _size (0), _capacity (INIT_CAPACITY)
+  {
+    buckets = new bucket[INIT_CAPACITY];
+    occupied.reset (INIT_CAPACITY);
+  }
 
   /**
    * Main Constructor
    * Gets a vector of KeyT type and a vector of ValueT type and inserts the
-   * key-value pairs by order to the buckets array
+   * key-value pairs by order to the buckets array (see bulk_assign)
    * @param keyVec
    * @param valVec
+   * @param num_threads most threads building the map
    */
-  HashMap (const std::vector<KeyT> &keyVec, const std::vector<ValueT> &valVec);
+  HashMap (const std::vector<KeyT> &keyVec, const std::vector<ValueT> &valVec,
+           int num_threads = default_threads ());
 
   /**
    * Copy Constructor
    * @param other
    */
-  HashMap (const HashMap<KeyT, ValueT> &other);
+  HashMap (const HashMap &other);
+
+  /**
+   * Move Constructor
+   * Takes over other's buckets without copying a pair. other is left empty
+   * with no buckets; it allocates them again on its next insert.
+   * @param other
+   */
+  HashMap (HashMap &&other) noexcept;
 
-  virtual ~HashMap (){delete[] buckets;} // Simple Destructor
+  virtual ~HashMap (){delete[] buckets; delete[] old_buckets;} // Destructor
 
   /**
    * Operator=
    * @param other
    * @return new HashMap, a deep copy of other
    */
-  HashMap &operator= (const HashMap<KeyT, ValueT> &other);
+  HashMap &operator= (const HashMap &other);
+
+  /**
+   * Move Operator=
+   * Swaps contents with other, which releases them when destroyed
+   * @param other
+   * @return this HashMap, holding other's pairs
+   */
+  HashMap &operator= (HashMap &&other) noexcept;
 
   // Getters and Checkers
   int size () const { return _size; }
   int capacity () const { return _capacity; }
   int bucket_size (const KeyT &key);
   int bucket_index (const KeyT &key) const;
-  double get_load_factor () const {return (double) _size / _capacity;}
-  bool contains_key (const KeyT &key) const;
+  double get_load_factor () const
+  {return _capacity ? (double) _size / _capacity : INIT;}
+  bool contains_key (const KeyT &key) const
+  { return contains_key<KeyT> (key); }
+  template<class K, class = key_arg<K>>
+  bool contains_key (const K &key) const;
   bool empty () const;
+  bool is_resizing () const {return old_buckets != nullptr;}
+
+  /**
+   * Fingerprint of the keys
+   * Order-independent sum of a mix of every key's hash, kept up to date by
+   * every insert and erase. Maps of stateless hash policies with the same
+   * keys have the same fingerprint; operator== rejects maps that differ in
+   * it in O(1). Values are not included, since they can change through
+   * references the map does not see.
+   * @return fingerprint
+   */
+  uint64_t fingerprint () const { return _fingerprint; }
+
+  /**
+   * Switch incremental resizing on or off (off by default).
+   * When on, a resize allocates the new bucket array but keeps the old one
+   * live; every non-const insert/erase/lookup then migrates at most
+   * MIGRATE_STEP old buckets, so no single call pays for the whole rehash.
+   * Const lookups consult both arrays without migrating.
+   * Switching it off finishes an ongoing migration.
+   * @param on
+   */
+  void set_incremental_rehash (bool on);
+
+  // Capacity management
+
+  /**
+   * Reserve Function
+   * Grows the map so that n pairs fit without any further resize.
+   * Never shrinks.
+   * @param n
+   * @throw std::length_error if n pairs need more than INT_MAX buckets
+   */
+  void reserve (int n);
+
+  /**
+   * Rehash Function
+   * Sets the capacity to the smallest power of two that is at least n and
+   * still holds all pairs (and the minimum capacity)
+   * @param n requested number of buckets
+   * @throw std::length_error if that capacity passes INT_MAX buckets
+   */
+  void rehash (int n);
+
+  /**
+   * Shrink To Fit Function
+   * Sets the smallest capacity that holds all pairs
+   */
+  void shrink_to_fit ();
+
+  /**
+   * Minimum capacity: erases never shrink the map below it, including the
+   * erase of the last pair (which otherwise shrinks it to ERASE_LAST_INIT).
+   * Grows the map to it if it is smaller.
+   * @param n rounded up to a power of two, must be positive
+   */
+  void set_min_capacity (int n);
+  int min_capacity () const { return _min_capacity; }
+
+  /**
+   * Load factor thresholds of growing and shrinking.
+   * The gap between them is the hysteresis of the map: a shrink must leave
+   * the load factor below max_load (min_load * MULT < max_load), so a
+   * workload that oscillates around one threshold stops resizing on every
+   * insert/erase pair. Defaults are LOAD_FACTOR_MAX and LOAD_FACTOR_MIN.
+   * @param max_load positive
+   * @param min_load non-negative, 0 means never shrink (except on the
+   * erase of the last pair)
+   */
+  void set_load_factors (double max_load, double min_load);
+  double max_load_factor () const { return _max_load; }
+  double min_load_factor () const { return _min_load; }
 
   // Operations
 
@@ -107,13 +685,113 @@ class HashMap {
    * @return true upon success
    */
   bool insert (const KeyT &key, const ValueT &value);
+  bool insert (KeyT &&key, ValueT &&value); // moves both into the map
+
+  /**
+   * Emplace Function
+   * Constructs a pair from args and moves it into the map if the map does
+   * not contain its key
+   * @param args arguments for std::pair<KeyT, ValueT> constructor
+   * @return true upon success
+   */
+  template<class... Args>
+  bool emplace (Args &&... args);
+
+  /**
+   * Try Emplace Function
+   * Constructs the value in place from args only if key is not in the map,
+   * otherwise leaves args untouched
+   * @param key
+   * @param args arguments for ValueT constructor
+   * @return true upon success
+   */
+  template<class... Args>
+  bool try_emplace (const KeyT &key, Args &&... args);
+  template<class... Args>
+  bool try_emplace (KeyT &&key, Args &&... args);
+
+  // Read-modify-write: one hash, one bucket scan and at most one resize
+  // check per call
+
+  /**
+   * Upsert Function
+   * Applies fn to the value of key, inserting a default ValueT first if key
+   * does not exist
+   * @param key
+   * @param fn callable as fn (ValueT &)
+   * @return the value of key after fn
+   */
+  template<class Fn>
+  ValueT &upsert (const KeyT &key, Fn fn);
+
+  /**
+   * Compute If Absent Function
+   * @param key
+   * @param factory callable as factory () -> ValueT, called only if key does
+   * not exist
+   * @return the value of key, existing or made by factory
+   */
+  template<class Factory>
+  ValueT &compute_if_absent (const KeyT &key, Factory factory);
+
+  /**
+   * Compute Function
+   * Calls fn on the value of key, or on a default ValueT if key does not
+   * exist. If fn returns false the key is removed (or never inserted).
+   * @param key
+   * @param fn callable as fn (ValueT &value, bool existed) -> bool keep
+   * @return true if key is in the map afterwards
+   */
+  template<class Fn>
+  bool compute (const KeyT &key, Fn fn);
+
+  /**
+   * Merge Value Function
+   * Inserts value if key does not exist, otherwise replaces the value of key
+   * with combiner (old value, value)
+   * @param key
+   * @param value
+   * @param combiner callable as combiner (const ValueT &, const ValueT &)
+   * @return the value of key after the merge
+   */
+  template<class Combiner>
+  ValueT &merge_value (const KeyT &key, const ValueT &value,
+                       Combiner combiner);
 
   /**
    * Erase pair
    * @param key
    * @return true upon success of operation
    */
-  virtual bool erase (const KeyT &key);
+  virtual bool erase (const KeyT &key) { return erase_key (key); }
+  template<class K, class = key_arg<K>>
+  bool erase (const K &key) { return erase_key (key); }
+
+  /**
+   * Erase pair at iterator
+   * Removes the pair in O(1) and never resizes, so other iterators stay
+   * valid, except those to the last pair of the same bucket (moved into
+   * the erased slot). For a sweep:
+   * for (auto it = map.mbegin (); it != map.mend ();)
+   *   it = expired (*it) ? map.erase (it) : ++it;
+   * the map shrinks at the next insert/erase by key, or at shrink_to_fit.
+   * The sweep may update it->second of the pairs it keeps; keys are const
+   * through an Iterator, so it cannot move a pair out of its bucket.
+   * @param pos iterator to a pair of this map (not end ())
+   * @return iterator to the pair after the erased one
+   */
+  Iterator erase (const ConstIterator &pos);
+
+  /**
+   * Erase If Function
+   * Removes every pair for which pred returns true in one pass, then
+   * adjusts the capacity at most once: to the capacity the same erases one
+   * by one would have left, with a single resize instead of one per halving.
+   * @param pred callable as pred (const std::pair<KeyT, ValueT> &) -> bool
+   * @return number of pairs removed
+   */
+  template<class Pred>
+  int erase_if (Pred pred);
 
   /**
    * Clear all pairs in buckets array
@@ -128,16 +806,93 @@ class HashMap {
    * @param key
    * @return ValueT if exists
    */
-  ValueT &at (const KeyT &key);
-  const ValueT &at (const KeyT &key) const; // const version
+  ValueT &at (const KeyT &key) { return at<KeyT> (key); }
+  const ValueT &at (const KeyT &key) const { return at<KeyT> (key); }
+  template<class K, class = key_arg<K>>
+  ValueT &at (const K &key);
+  template<class K, class = key_arg<K>>
+  const ValueT &at (const K &key) const; // const version
 
   /**
    * Operator []
+   * A transparent key is converted to KeyT only when it is inserted
    * @param key
    * @return ValueT if exists
    */
-  ValueT &operator[] (const KeyT &key);
-  const ValueT &operator[] (const KeyT &key) const; // const version
+  ValueT &operator[] (const KeyT &key) { return operator[]<KeyT> (key); }
+  const ValueT &operator[] (const KeyT &key) const { return at<KeyT> (key); }
+  template<class K, class = key_arg<K>>
+  ValueT &operator[] (const K &key);
+  template<class K, class = key_arg<K>>
+  const ValueT &operator[] (const K &key) const { return at (key); }
+
+  // Exception-free lookups
+  // Every lookup by key (contains_key, at, [], erase, find, try_get, get_or)
+  // also takes any K that the Hash and KeyEqual policies take, if both are
+  // transparent, e.g. a std::string_view or a const char * for std::string
+  // keys (see hash_default): no KeyT is built to look it up.
+
+  using const_iterator = ConstIterator;
+  using iterator = Iterator;
+
+  /**
+   * Find Function
+   * Single probe, never throws
+   * @param key
+   * @return iterator to the pair of key, or end () if key does not exist
+   */
+  iterator find (const KeyT &key) { return find<KeyT> (key); }
+  const_iterator find (const KeyT &key) const { return find<KeyT> (key); }
+  template<class K, class = key_arg<K>>
+  iterator find (const K &key);
+  template<class K, class = key_arg<K>>
+  const_iterator find (const K &key) const;
+
+  /**
+   * Try Get Function
+   * @param key
+   * @return pointer to the value of key, or nullptr if key does not exist
+   */
+  ValueT *try_get (const KeyT &key) { return try_get<KeyT> (key); }
+  const ValueT *try_get (const KeyT &key) const { return try_get<KeyT> (key); }
+  template<class K, class = key_arg<K>>
+  ValueT *try_get (const K &key);
+  template<class K, class = key_arg<K>>
+  const ValueT *try_get (const K &key) const;
+
+  /**
+   * Get Or Function
+   * @param key
+   * @param default_value
+   * @return copy of the value of key, or default_value if key does not exist
+   */
+  ValueT get_or (const KeyT &key, const ValueT &default_value) const
+  { return get_or<KeyT> (key, default_value); }
+  template<class K, class = key_arg<K>>
+  ValueT get_or (const K &key, const ValueT &default_value) const;
+
+  // Batched lookups, faster than a loop over at () on maps that do not fit
+  // in cache
+
+  /**
+   * Lookup Many Function
+   * @param keys array of n keys
+   * @param n
+   * @param out array of n pointers, out[i] is set to the value of keys[i], or
+   * nullptr if it does not exist
+   * @return number of keys found
+   */
+  size_t lookup_many (const KeyT *keys, size_t n, ValueT **out);
+  size_t lookup_many (const KeyT *keys, size_t n, const ValueT **out) const;
+
+  /**
+   * Contains Many Function
+   * @param keys array of n keys
+   * @param n
+   * @param out array of n bools, out[i] is set to whether keys[i] exists
+   * @return number of keys found
+   */
+  size_t contains_many (const KeyT *keys, size_t n, bool *out) const;
 
   /**
    * Operator ==
@@ -148,19 +903,59 @@ class HashMap {
   bool operator== (const HashMap &other) const;
   bool operator!= (const HashMap &other) const;
 
+  /**
+   * Ranges Function
+   * Splits the buckets into at most n disjoint spans of about the same
+   * number of buckets, for parallel iteration (see Parallel.hpp)
+   * @param n
+   * @return begin and end iterators of every span, together they visit
+   * every pair exactly once
+   */
+  std::vector<std::pair<const_iterator, const_iterator>> ranges (int n) const;
+
+  /**
+   * Freeze Function
+   * Compact, read-only snapshot of this map for read-mostly serving: a
+   * minimal perfect hash over one contiguous array of pairs, with no empty
+   * slots or per-bucket vectors (defined in FrozenHashMap.hpp)
+   * @return FrozenHashMap with the same pairs and policies
+   */
+  FrozenHashMap<KeyT, ValueT, Hash, KeyEqual> freeze () const;
+
+  /**
+   * Save Snapshot Function
+   * Writes the pairs to path as a position-independent, checksummed image
+   * that MappedHashMap::open maps and serves without loading (defined in
+   * Snapshot.hpp). Keys are std::string, integral or enum, compared by
+   * the default KeyEqual; values are std::string or trivially copyable
+   * (see snapshot_key, snapshot_codec). Throws std::length_error, before
+   * writing anything, for a key or value longer than UINT32_MAX bytes.
+   * @param path
+   */
+  void save_snapshot (const std::string &path) const;
+
   // Begin & End functions
-  class ConstIterator;
-  using const_iterator = ConstIterator;
   const_iterator begin () const {return ConstIterator (*this, true);}
   const_iterator cbegin () const {return begin ();}
   const_iterator end () const {return ConstIterator (*this, false);}
   const_iterator cend () const {return end ();}
+  // Mutable iteration, whose pairs' values may be modified and erased
+  iterator mbegin () {return Iterator (*this, next_occupied (INIT), INIT);}
+  iterator mend () {return Iterator (*this, bucket_total (), INIT);}
 
   // Nested class - ConstIterator
   class ConstIterator {
+    friend class HashMap;
+   protected:
     // Privates
     int bucket_ind, pair_ind; // Indexes of Iterator
-    const HashMap<KeyT, ValueT> & hash_map; // hash_map to iterate on
+    const HashMap * hash_map; // hash_map to iterate on
+
+    /**
+     * Constructor of an iterator to a known pair
+     */
+    ConstIterator (const HashMap& hash_map, int bucket_ind, int pair_ind)
+    : bucket_ind (bucket_ind), pair_ind (pair_ind), hash_map (&hash_map) {}
    public:
     // Iterator traits:
     typedef std::pair<KeyT, ValueT> value_type;
@@ -169,12 +964,19 @@ class HashMap {
     typedef std::ptrdiff_t difference_type;
     typedef std::forward_iterator_tag iterator_category;
 
+    /**
+     * Default Constructor, a singular iterator of no map, which may only be
+     * assigned to
+     */
+    ConstIterator () : bucket_ind (INIT), pair_ind (INIT), hash_map (nullptr)
+    {}
+
     /**
      * Constructor
      * @param hash_map
      * @param is_begin
      */
-    ConstIterator (const HashMap<KeyT, ValueT>& hash_map, bool is_begin);
+    ConstIterator (const HashMap& hash_map, bool is_begin);
 
     /**
      * Forward Iterator (rhs)
@@ -182,25 +984,13 @@ class HashMap {
      */
     ConstIterator operator++ ()
     {
-      if (bucket_ind >= hash_map.capacity ())
-        {
-          throw std::invalid_argument (INVALID_MSG);
-        }
-      if (pair_ind < hash_map.buckets[bucket_ind].size () - 1)
+      // Incrementing end () is undefined, as for the standard containers
+      if (pair_ind + 1 < (int) hash_map->bucket_at (bucket_ind).size ())
         {
           pair_ind++;
           return *this;
         }
-      for (int i = bucket_ind + 1; i < hash_map.capacity (); i++)
-        {
-          if (!hash_map.buckets[i].empty ())
-            {
-              pair_ind = 0;
-              bucket_ind = i;
-              return *this;
-            }
-        }
-      bucket_ind = hash_map.capacity ();
+      bucket_ind = hash_map->next_occupied (bucket_ind + 1);
       pair_ind = 0;
       return *this;
     }
@@ -222,11 +1012,11 @@ class HashMap {
      * @return true if the iterators point to same pair in same HashMap object
      */
     bool operator== (const ConstIterator &rhs) const
-    { return (std::addressof(this->hash_map) == std::addressof(rhs.hash_map)
+    { return (this->hash_map == rhs.hash_map
     && bucket_ind == rhs.bucket_ind && pair_ind == rhs.pair_ind); }
 
     bool operator== (ConstIterator &rhs) const
-    { return (std::addressof(this->hash_map) == std::addressof(rhs.hash_map)
+    { return (this->hash_map == rhs.hash_map
     && bucket_ind == rhs.bucket_ind && pair_ind == rhs.pair_ind); }
 
     bool operator!= (const ConstIterator &rhs) const
@@ -237,10 +1027,10 @@ class HashMap {
 
     // Access and Assigment operators
     reference operator* ()
-    { return hash_map.buckets[bucket_ind][pair_ind]; }
+    { return hash_map->bucket_at (bucket_ind)[pair_ind]; }
 
     reference operator* () const
-    { return hash_map.buckets[bucket_ind][pair_ind]; }
+    { return hash_map->bucket_at (bucket_ind)[pair_ind]; }
 
     pointer operator-> ()
     { return &(operator* ()); }
@@ -248,48 +1038,244 @@ class HashMap {
     pointer operator-> () const
     { return &(operator* ()); }
   };
+
+  // Nested class - Iterator
+  // A ConstIterator whose values can be modified, its keys stay const
+  class Iterator : public ConstIterator {
+    friend class HashMap;
+    Iterator (HashMap& hash_map, int bucket_ind, int pair_ind)
+    : ConstIterator (hash_map, bucket_ind, pair_ind) {}
+   public:
+    /**
+     * A pair seen through an Iterator: a const key and a mutable value.
+     * Writing a key in place would leave its pair in the wrong bucket, with
+     * a stale cached hash, split key and fingerprint.
+     */
+    struct PairRef {
+      const KeyT &first;
+      ValueT &second;
+      const PairRef *operator-> () const { return this; }
+      operator std::pair<KeyT, ValueT> () const { return {first, second}; }
+    };
+
+    // Iterator traits:
+    typedef std::pair<KeyT, ValueT> value_type;
+    typedef PairRef reference;
+    typedef PairRef pointer;
+    typedef std::ptrdiff_t difference_type;
+    typedef std::forward_iterator_tag iterator_category;
+
+    Iterator &operator++ ()
+    {
+      ConstIterator::operator++ ();
+      return *this;
+    }
+
+    Iterator operator++ (int)
+    {
+      Iterator tmp_it(*this);
+      ++(*this);
+      return tmp_it;
+    }
+
+    // Only created from a non-const map, so the value is not really const
+    reference operator* () const
+    {
+      const value_type &pair = ConstIterator::operator* ();
+      return {pair.first, const_cast<ValueT &> (pair.second)};
+    }
+
+    pointer operator-> () const
+    { return operator* (); }
+  };
 };
 
-template<class KeyT, class ValueT>
-int HashMap<KeyT,ValueT>:: hash_func (const KeyT &key) const
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+int HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: hash_func
+    (const KeyT &key) const
 {
-  int x = std::hash<KeyT>{}(key);
-  return x & (_capacity - HASH_HELP);
+  return bucket_of (full_hash (key), _capacity);
 }
 
-template<class KeyT, class ValueT>
-HashMap<KeyT,ValueT>:: HashMap (const std::vector<KeyT> &keyVec,
-                                const std::vector<ValueT> &valVec): HashMap ()
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+template<class K>
+size_t HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: full_hash
+    (const K &key) const
 {
-  if (keyVec.size () != valVec.size ())
+  size_t x = _hasher (key);
+  if (!hash_is_avalanching<Hash>::value)
     {
-      throw std::length_error (VECTOR_LENGTH);
+      x = hash_mix (x);
     }
-  for (int i = 0; i < (int) keyVec.size (); i++)
+  return x;
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+int HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: locate_index
+    (size_t hash) const
+{
+  if (old_buckets)
     {
-      (*this)[keyVec[i]] = valVec[i];
+      int old_ind = bucket_of (hash, _old_capacity);
+      if (old_ind >= _migrate_pos)
+        {
+          return _capacity + old_ind;
+        }
     }
-};
+  return bucket_of (hash, _capacity);
+}
 
-template<class KeyT, class ValueT>
-HashMap<KeyT,ValueT>:: HashMap (const HashMap<KeyT, ValueT> &other)
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+typename HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>::bucket &
+HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: locate_bucket
+    (size_t hash)
 {
-  _size=INIT;
-  _capacity = other._capacity;
-  buckets = new bucket[_capacity];
-  for (int i = 0; i < _capacity; i++)
+  ensure_buckets ();
+  return bucket_at (locate_index (hash));
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+const typename HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>::bucket &
+HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: locate_bucket
+    (size_t hash) const
+{
+  static const bucket no_bucket;
+  if (_capacity == INIT)
     {
-      for (int j = 0; j < (int) other.buckets[i].size (); j++)
+      return no_bucket; // moved-from map
+    }
+  return bucket_at (locate_index (hash));
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+template<class K>
+int HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: find_in
+    (const bucket &key_bucket, const K &key, size_t hash) const
+{
+  return key_bucket.find (key, hash, _key_equal);
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+size_t HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: hash_at
+    (const bucket &key_bucket, int ind) const
+{
+  return key_bucket.hash_at (ind, [this] (const KeyT &key)
+  { return full_hash (key); });
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+void HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: copy_pairs
+    (const HashMap &other)
+{
+  // Lands every pair in its final bucket, even if other is mid-resize
+  for (int ind = 0; ind < other.bucket_total (); ind++)
+    {
+      const bucket &other_bucket = other.bucket_at (ind);
+      for (int i = 0; i < other_bucket.size (); i++)
         {
-          buckets[i].push_back (other.buckets[i][j]);
+          size_t hash = other.hash_at (other_bucket, i);
+          int new_ind = bucket_of (hash, _capacity);
+          buckets[new_ind].emplace_back (hash, other_bucket[i]);
+          occupied.set (new_ind);
           _size++;
+          _fingerprint += key_print (hash);
         }
     }
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: HashMap
+    (const std::vector<KeyT> &keyVec, const std::vector<ValueT> &valVec,
+     int num_threads)
+    : HashMap ()
+{
+  if (keyVec.size () != valVec.size ())
+    {
+      throw std::length_error (VECTOR_LENGTH);
+    }
+  bulk_assign ((int) keyVec.size (),
+               [&keyVec] (int i) -> const KeyT & { return keyVec[i]; },
+               [&valVec] (int i) -> const ValueT & { return valVec[i]; },
+               num_threads);
+};
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: HashMap
+    (const HashMap &other)
+{
+  _size=INIT;
+  _fingerprint = INIT;
+  _capacity = other._capacity;
+  _hasher = other._hasher;
+  _key_equal = other._key_equal;
+  _incremental = other._incremental;
+  _max_load = other._max_load;
+  _min_load = other._min_load;
+  _min_capacity = other._min_capacity;
+  buckets = new bucket[_capacity];
+  occupied.reset (_capacity);
+  copy_pairs (other);
 };
 
-template<class KeyT, class ValueT>
-HashMap<KeyT,ValueT>& HashMap<KeyT,ValueT>:: operator=
-    (const HashMap<KeyT, ValueT> &other)
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: HashMap
+    (HashMap &&other) noexcept
+    : buckets (other.buckets), _size (other._size),
+      _capacity (other._capacity), _hasher (other._hasher),
+      _key_equal (other._key_equal), _incremental (other._incremental),
+      old_buckets (other.old_buckets), _old_capacity (other._old_capacity),
+      _migrate_pos (other._migrate_pos), _max_load (other._max_load),
+      _min_load (other._min_load), _min_capacity (other._min_capacity),
+      occupied (std::move (other.occupied)),
+      old_occupied (std::move (other.old_occupied)),
+      _fingerprint (other._fingerprint)
+{
+  other._fingerprint = INIT;
+  other.buckets = other.old_buckets = nullptr;
+  other._size = other._capacity = other._old_capacity = INIT;
+  other._migrate_pos = INIT;
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>&
+HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: operator=
+    (HashMap &&other) noexcept
+{
+  std::swap (buckets, other.buckets);
+  std::swap (_size, other._size);
+  std::swap (_capacity, other._capacity);
+  std::swap (_hasher, other._hasher);
+  std::swap (_key_equal, other._key_equal);
+  std::swap (_incremental, other._incremental);
+  std::swap (old_buckets, other.old_buckets);
+  std::swap (_old_capacity, other._old_capacity);
+  std::swap (_migrate_pos, other._migrate_pos);
+  std::swap (_max_load, other._max_load);
+  std::swap (_min_load, other._min_load);
+  std::swap (_min_capacity, other._min_capacity);
+  std::swap (occupied, other.occupied);
+  std::swap (old_occupied, other.old_occupied);
+  std::swap (_fingerprint, other._fingerprint);
+  return *this;
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>&
+HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: operator=
+    (const HashMap &other)
 {
   if (this == &other)
     {
@@ -298,57 +1284,156 @@ HashMap<KeyT,ValueT>& HashMap<KeyT,ValueT>:: operator=
   clear ();
   delete[] buckets;
   _capacity = other._capacity;
+  _hasher = other._hasher;
+  _key_equal = other._key_equal;
+  _incremental = other._incremental;
+  _max_load = other._max_load;
+  _min_load = other._min_load;
+  _min_capacity = other._min_capacity;
   _size = INIT;
+  _fingerprint = INIT;
   buckets = new bucket[_capacity];
-  for (int i = 0; i < _capacity; i++)
+  occupied.reset (_capacity);
+  copy_pairs (other);
+  return *this;
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+template<class K, class>
+bool HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: contains_key
+    (const K &key) const
+{
+  size_t hash = full_hash (key);
+  return find_in (locate_bucket (hash), key, hash) != -1;
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+bool HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: insert
+    (const KeyT &key, const ValueT &value)
+{
+  migrate_step ();
+  size_t hash = full_hash (key);
+  if (find_in (locate_bucket (hash), key, hash) != -1)
     {
-      for (int j = 0; j < other.buckets[i].size (); j++)
-        {
-          buckets[i].push_back (other.buckets[i][j]);
-          _size++;
-        }
+      return false;
     }
-  return *this;
+  emplace_new (hash, key, value);
+  return true;
 }
 
-template<class KeyT, class ValueT>
-bool HashMap<KeyT,ValueT>:: contains_key (const KeyT &key) const
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+bool HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: insert
+    (KeyT &&key, ValueT &&value)
 {
-  int key_ind = hash_func (key);
-  for (int i=0;i< (int) buckets[key_ind].size();i++)
+  migrate_step ();
+  size_t hash = full_hash (key);
+  if (find_in (locate_bucket (hash), key, hash) != -1)
     {
-      if (buckets[key_ind][i].first == key)
-        {
-          return true;
-        }
+      return false;
     }
-  return false;
+  emplace_new (hash, std::move (key), std::move (value));
+  return true;
 }
 
-template<class KeyT, class ValueT>
-bool HashMap<KeyT,ValueT>:: insert (const KeyT &key, const ValueT &value)
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+template<class... Args>
+bool HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: emplace
+    (Args &&... args)
 {
-  if (contains_key (key))
+  std::pair<KeyT, ValueT> new_pair (std::forward<Args> (args)...);
+  migrate_step ();
+  size_t hash = full_hash (new_pair.first);
+  if (find_in (locate_bucket (hash), new_pair.first, hash) != -1)
     {
       return false;
     }
-  int bucket_index = hash_func (key);
-  auto new_pair = std::pair<KeyT, ValueT> (key, value);
-  buckets[bucket_index].push_back (new_pair);
-  _size++;
-  update_capacity (true);
+  emplace_new (hash, std::move (new_pair));
+  return true;
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+template<class... Args>
+bool HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: try_emplace
+    (const KeyT &key, Args &&... args)
+{
+  migrate_step ();
+  size_t hash = full_hash (key);
+  if (find_in (locate_bucket (hash), key, hash) != -1)
+    {
+      return false;
+    }
+  emplace_new (hash, std::piecewise_construct, std::forward_as_tuple (key),
+               std::forward_as_tuple (std::forward<Args> (args)...));
   return true;
 }
 
-template<class KeyT, class ValueT>
-bool HashMap<KeyT,ValueT>:: empty () const
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+template<class... Args>
+bool HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: try_emplace
+    (KeyT &&key, Args &&... args)
+{
+  migrate_step ();
+  size_t hash = full_hash (key);
+  if (find_in (locate_bucket (hash), key, hash) != -1)
+    {
+      return false;
+    }
+  emplace_new (hash, std::piecewise_construct,
+               std::forward_as_tuple (std::move (key)),
+               std::forward_as_tuple (std::forward<Args> (args)...));
+  return true;
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+template<class... Args>
+std::pair<KeyT, ValueT> &
+HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: emplace_new
+    (size_t hash, Args &&... args)
+{
+  // Count the pair first so the resize check sees it, then place it in
+  // the bucket it belongs to after the resize
+  _size++;
+  try
+    {
+      update_capacity (true);
+      bucket &key_bucket = locate_bucket (hash);
+      key_bucket.emplace_back (hash, std::forward<Args> (args)...);
+      set_occupied (locate_index (hash), true);
+      _fingerprint += key_print (hash);
+      return key_bucket[key_bucket.size () - 1];
+    }
+  catch (...)
+    {
+      _size--;
+      throw;
+    }
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+bool HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: empty () const
 {
   return (_size==INIT);
 }
 
-template<class KeyT, class ValueT>
-void HashMap<KeyT,ValueT>:: clear ()
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+void HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: clear ()
 {
+  if (old_buckets)
+    {
+      delete[] old_buckets;
+      old_buckets = nullptr;
+      _old_capacity = _migrate_pos = INIT;
+      old_occupied.reset (INIT);
+    }
   if (empty ())
     {
       return;
@@ -357,41 +1442,203 @@ void HashMap<KeyT,ValueT>:: clear ()
     {
       buckets[i].clear();
     }
+  occupied.reset (_capacity);
   _size = INIT;
+  _fingerprint = INIT;
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+template<class K>
+bool HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: erase_key
+    (const K &key)
+{
+  migrate_step ();
+  size_t hash = full_hash (key);
+  bucket &key_bucket = locate_bucket (hash);
+  int ind = find_in (key_bucket, key, hash);
+  if (ind == -1)
+    {
+      return false;
+    }
+  erase_at (locate_index (hash), ind, hash);
+  return true;
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+void HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: erase_at
+    (int bucket_ind, int ind, size_t hash)
+{
+  remove_at (bucket_ind, ind, hash);
+  update_capacity (false);
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+void HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: remove_at
+    (int bucket_ind, int ind, size_t hash)
+{
+  bucket &key_bucket = bucket_at (bucket_ind);
+  key_bucket.swap_erase (ind);
+  if (key_bucket.empty ())
+    {
+      set_occupied (bucket_ind, false);
+    }
+  --_size;
+  _fingerprint -= key_print (hash);
 }
 
-template<class KeyT, class ValueT>
-bool HashMap<KeyT,ValueT>:: erase (const KeyT &key)
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+typename HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>::Iterator
+HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: erase
+    (const ConstIterator &pos)
 {
-  int key_ind = hash_func (key);
-  auto pair_it = buckets[key_ind].begin ();
-  while (pair_it != buckets[key_ind].end())
+  int bucket_ind = pos.bucket_ind, ind = pos.pair_ind;
+  remove_at (bucket_ind, ind, hash_at (bucket_at (bucket_ind), ind));
+  // The bucket's last pair, not visited yet, now sits at ind
+  if (ind < bucket_at (bucket_ind).size ())
     {
-      if (pair_it->first == key)
+      return Iterator (*this, bucket_ind, ind);
+    }
+  return Iterator (*this, next_occupied (bucket_ind + 1), INIT);
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+template<class Pred>
+int HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: erase_if
+    (Pred pred)
+{
+  int removed = INIT;
+  for (int b = next_occupied (INIT); b < bucket_total ();
+       b = next_occupied (b + 1))
+    {
+      bucket &cur = bucket_at (b);
+      for (int i = 0; i < cur.size ();)
+        {
+          if (pred (static_cast<const std::pair<KeyT, ValueT> &> (cur[i])))
+            {
+              remove_at (b, i, hash_at (cur, i));
+              removed++;
+            }
+          else
+            {
+              i++;
+            }
+        }
+    }
+  int new_capacity = shrunk_capacity ();
+  if (new_capacity < _capacity)
+    {
+      resize (new_capacity);
+    }
+  return removed;
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+template<class Fn>
+ValueT & HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: upsert
+    (const KeyT &key, Fn fn)
+{
+  migrate_step ();
+  size_t hash = full_hash (key);
+  bucket &key_bucket = locate_bucket (hash);
+  int ind = find_in (key_bucket, key, hash);
+  if (ind != -1)
+    {
+      fn (key_bucket[ind].second);
+      return key_bucket[ind].second;
+    }
+  // fn runs before the pair is placed, so a throwing fn inserts nothing
+  ValueT value = ValueT ();
+  fn (value);
+  return emplace_new (hash, key, std::move (value)).second;
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+template<class Factory>
+ValueT &
+HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: compute_if_absent
+    (const KeyT &key, Factory factory)
+{
+  migrate_step ();
+  size_t hash = full_hash (key);
+  bucket &key_bucket = locate_bucket (hash);
+  int ind = find_in (key_bucket, key, hash);
+  if (ind != -1)
+    {
+      return key_bucket[ind].second;
+    }
+  return emplace_new (hash, key, factory ()).second;
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+template<class Fn>
+bool HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: compute
+    (const KeyT &key, Fn fn)
+{
+  migrate_step ();
+  size_t hash = full_hash (key);
+  bucket &key_bucket = locate_bucket (hash);
+  int ind = find_in (key_bucket, key, hash);
+  if (ind != -1)
+    {
+      if (fn (key_bucket[ind].second, true))
         {
-          buckets[key_ind].erase (pair_it);
-          --_size;
-          update_capacity (false);
           return true;
         }
-      pair_it++;
+      erase_at (locate_index (hash), ind, hash);
+      return false;
     }
-  return false;
+  ValueT value = ValueT ();
+  if (!fn (value, false))
+    {
+      return false;
+    }
+  emplace_new (hash, key, std::move (value));
+  return true;
 }
 
-template<class KeyT, class ValueT>
-int HashMap<KeyT,ValueT>:: bucket_size (const KeyT &key)
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+template<class Combiner>
+ValueT & HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: merge_value
+    (const KeyT &key, const ValueT &value, Combiner combiner)
+{
+  migrate_step ();
+  size_t hash = full_hash (key);
+  bucket &key_bucket = locate_bucket (hash);
+  int ind = find_in (key_bucket, key, hash);
+  if (ind != -1)
+    {
+      ValueT &old_value = key_bucket[ind].second;
+      old_value = combiner (old_value, value);
+      return old_value;
+    }
+  return emplace_new (hash, key, value).second;
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+int HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: bucket_size
+    (const KeyT &key)
 {
   if (!contains_key (key))
     {
       throw std::invalid_argument(INVALID_MSG);
     }
-  int key_ind = hash_func (key);
-  return buckets[key_ind].size ();
+  return locate_bucket (full_hash (key)).size ();
 }
 
-template<class KeyT, class ValueT>
-int HashMap<KeyT,ValueT>:: bucket_index (const KeyT &key) const
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+int HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: bucket_index
+    (const KeyT &key) const
 {
   if (!contains_key (key))
     {
@@ -400,74 +1647,283 @@ int HashMap<KeyT,ValueT>:: bucket_index (const KeyT &key) const
   return hash_func (key);
 }
 
-template<class KeyT, class ValueT>
-ValueT& HashMap<KeyT,ValueT>:: at (const KeyT &key)
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+template<class K, class>
+ValueT& HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: at
+    (const K &key)
 {
-  int ind = hash_func (key);
-  int length = buckets[ind].size ();
-  for (int i = 0; i < length; i++)
+  migrate_step ();
+  size_t hash = full_hash (key);
+  bucket &key_bucket = locate_bucket (hash);
+  int ind = find_in (key_bucket, key, hash);
+  if (ind == -1)
     {
-      if (buckets[ind][i].first == key)
-        {
-          return buckets[ind][i].second;
-        }
+      throw std::invalid_argument (KEY_NOT_FOUND);
     }
-  throw std::invalid_argument (KEY_NOT_FOUND);
+  return key_bucket[ind].second;
 }
 
-template<class KeyT, class ValueT>
-const ValueT & HashMap<KeyT,ValueT>:: at (const KeyT &key) const
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+template<class K, class>
+const ValueT & HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: at
+    (const K &key) const
 {
-  int ind = hash_func (key);
-  for (int i = 0; i < (int) buckets[ind].size (); i++)
+  size_t hash = full_hash (key);
+  const bucket &key_bucket = locate_bucket (hash);
+  int ind = find_in (key_bucket, key, hash);
+  if (ind == -1)
     {
-      if (buckets[ind][i].first == key)
-        {
-          return buckets[ind][i].second;
-        }
+      throw std::invalid_argument (INVALID_MSG);
     }
-  throw std::invalid_argument (INVALID_MSG);
+  return key_bucket[ind].second;
 }
 
-template<class KeyT, class ValueT>
-ValueT & HashMap<KeyT,ValueT>:: operator[] (const KeyT &key)
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+template<class K, class>
+ValueT & HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: operator[]
+    (const K &key)
 {
-  try
+  migrate_step ();
+  size_t hash = full_hash (key);
+  bucket &key_bucket = locate_bucket (hash);
+  int ind = find_in (key_bucket, key, hash);
+  if (ind != -1)
+    {
+      return key_bucket[ind].second;
+    }
+  return emplace_new (hash, std::piecewise_construct,
+                      std::forward_as_tuple (key), std::tuple<> ()).second;
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+template<class K, class>
+typename HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>::iterator
+HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: find (const K &key)
+{
+  migrate_step ();
+  size_t hash = full_hash (key);
+  int ind = find_in (locate_bucket (hash), key, hash);
+  if (ind == -1)
     {
-      ValueT& val = at (key);
-      return val;
+      return iterator (*this, bucket_total (), INIT);
     }
-  catch (const std::invalid_argument &e)
+  return iterator (*this, locate_index (hash), ind);
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+template<class K, class>
+typename HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>::const_iterator
+HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: find
+    (const K &key) const
+{
+  size_t hash = full_hash (key);
+  int ind = find_in (locate_bucket (hash), key, hash);
+  if (ind == -1)
     {
-      buckets[hash_func (key)].push_back
-      (std::pair<KeyT, ValueT> (key, ValueT ()));
-      _size++;
-      update_capacity (true);
-      return at (key);
+      return end ();
     }
+  return const_iterator (*this, locate_index (hash), ind);
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+template<class K, class>
+ValueT *HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: try_get
+    (const K &key)
+{
+  migrate_step ();
+  size_t hash = full_hash (key);
+  bucket &key_bucket = locate_bucket (hash);
+  int ind = find_in (key_bucket, key, hash);
+  return ind == -1 ? nullptr : &key_bucket[ind].second;
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+template<class K, class>
+const ValueT *HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: try_get
+    (const K &key) const
+{
+  size_t hash = full_hash (key);
+  const bucket &key_bucket = locate_bucket (hash);
+  int ind = find_in (key_bucket, key, hash);
+  return ind == -1 ? nullptr : &key_bucket[ind].second;
 }
 
-template<class KeyT, class ValueT>
-const ValueT & HashMap<KeyT,ValueT>:: operator[] (const KeyT &key) const
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+template<class K, class>
+ValueT HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: get_or
+    (const K &key, const ValueT &default_value) const
 {
-  return at (key);
+  const ValueT *value = try_get (key);
+  return value ? *value : default_value;
 }
 
-template<class KeyT, class ValueT>
-bool HashMap<KeyT,ValueT>:: operator== (const HashMap<KeyT,ValueT> &other)
-    const
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+template<class Emit>
+size_t HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: find_many
+    (const KeyT *keys, size_t n, Emit emit) const
 {
+  size_t hashes[LOOKUP_BATCH];
+  const bucket *key_buckets[LOOKUP_BATCH];
+  size_t found = INIT;
+  for (size_t start = 0; start < n; start += LOOKUP_BATCH)
+    {
+      size_t count = std::min ((size_t) LOOKUP_BATCH, n - start);
+      for (size_t j = 0; j < count; j++)
+        {
+          hashes[j] = full_hash (keys[start + j]);
+          key_buckets[j] = &locate_bucket (hashes[j]);
+          prefetch_read (key_buckets[j]);
+        }
+      for (size_t j = 0; j < count; j++)
+        {
+          key_buckets[j]->prefetch ();
+        }
+      for (size_t j = 0; j < count; j++)
+        {
+          int ind = find_in (*key_buckets[j], keys[start + j], hashes[j]);
+          if (ind != -1)
+            {
+              found++;
+            }
+          emit (start + j, ind == -1 ? nullptr : &(*key_buckets[j])[ind]);
+        }
+    }
+  return found;
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+size_t HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: lookup_many
+    (const KeyT *keys, size_t n, ValueT **out)
+{
+  migrate_step ();
+  // The map is not const, so neither are its values
+  return find_many (keys, n, [out] (size_t i,
+                                    const std::pair<KeyT, ValueT> *found)
+  { out[i] = found ? const_cast<ValueT *> (&found->second) : nullptr; });
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+size_t HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: lookup_many
+    (const KeyT *keys, size_t n, const ValueT **out) const
+{
+  return find_many (keys, n, [out] (size_t i,
+                                    const std::pair<KeyT, ValueT> *found)
+  { out[i] = found ? &found->second : nullptr; });
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+size_t HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: contains_many
+    (const KeyT *keys, size_t n, bool *out) const
+{
+  return find_many (keys, n, [out] (size_t i,
+                                    const std::pair<KeyT, ValueT> *found)
+  { out[i] = found != nullptr; });
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+std::vector<std::pair<
+    typename HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>::
+    const_iterator,
+    typename HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>::
+    const_iterator>>
+HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: ranges (int n) const
+{
+  if (n <= INIT)
+    {
+      throw std::invalid_argument (INVALID_MSG);
+    }
+  std::vector<std::pair<const_iterator, const_iterator>> spans;
+  int total = bucket_total ();
+  n = std::max (1, std::min (n, total));
+  const_iterator first = begin ();
+  for (int i = 1; i <= n; i++)
+    {
+      int bucket_end = (int) ((long long) total * i / n);
+      const_iterator last (*this, next_occupied (bucket_end), INIT);
+      if (first != last)
+        {
+          spans.emplace_back (first, last);
+        }
+      first = last;
+    }
+  return spans;
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+bool HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: operator==
+    (const HashMap &other) const
+{
+  if (this == &other)
+    {
+      return true;
+    }
   if (_size != other._size)
     {
       return false;
     }
-  for (int i=0;i< (int) other._capacity;i++){
-      for (auto& it : other.buckets[i]){
-          if (!contains_key (it.first))
+  if (same_policies ())
+    {
+      if (_fingerprint != other._fingerprint)
+        {
+          return false;
+        }
+      if (_capacity == other._capacity && !old_buckets && !other.old_buckets)
+        {
+          return equal_buckets (other);
+        }
+    }
+  for (auto& it : other){
+      const ValueT *value = try_get (it.first);
+      if (!value || it.second != *value)
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+bool HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: equal_buckets
+    (const HashMap &other) const
+{
+  for (int b = occupied.next (INIT); b != -1; b = occupied.next (b + 1))
+    {
+      const bucket &this_bucket = buckets[b];
+      const bucket &other_bucket = other.buckets[b];
+      if (this_bucket.size () != other_bucket.size ())
+        {
+          return false;
+        }
+      for (int i = 0; i < this_bucket.size (); i++)
+        {
+          // Maps built in the same order keep the same order in a bucket
+          int other_ind = i;
+          if (!_key_equal (this_bucket[i].first, other_bucket[i].first))
             {
-              return false;
+              other_ind = other_bucket.find (this_bucket[i].first,
+                                             this_bucket.stored_hash (i),
+                                             _key_equal);
+              if (other_ind == -1)
+                {
+                  return false;
+                }
             }
-          if (it.second != at (it.first))
+          if (this_bucket[i].second != other_bucket[other_ind].second)
             {
               return false;
             }
@@ -476,42 +1932,137 @@ bool HashMap<KeyT,ValueT>:: operator== (const HashMap<KeyT,ValueT> &other)
   return true;
 }
 
-template<class KeyT, class ValueT>
-bool HashMap<KeyT,ValueT>:: operator!= (const HashMap &other) const
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+bool HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: operator!=
+    (const HashMap &other) const
 {
   return !(operator== (other));
 }
 
-template<class KeyT, class ValueT>
-void HashMap<KeyT,ValueT>:: rehash (double mult)
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+void
+HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: set_incremental_rehash
+    (bool on)
+{
+  _incremental = on;
+  if (!on)
+    {
+      finish_migration ();
+    }
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+void HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: migrate_step ()
+{
+  if (!old_buckets)
+    {
+      return;
+    }
+  int stop = std::min (_migrate_pos + MIGRATE_STEP, _old_capacity);
+  for (; _migrate_pos < stop; _migrate_pos++)
+    {
+      bucket &old_bucket = old_buckets[_migrate_pos];
+      for (int i = 0; i < old_bucket.size (); i++){
+          size_t hash = hash_at (old_bucket, i);
+          int new_ind = bucket_of (hash, _capacity);
+          buckets[new_ind].emplace_back (hash, std::move (old_bucket[i]));
+          occupied.set (new_ind);
+        }
+      old_bucket.clear ();
+      old_occupied.unset (_migrate_pos);
+    }
+  if (_migrate_pos == _old_capacity)
+    {
+      delete[] old_buckets;
+      old_buckets = nullptr;
+      _old_capacity = _migrate_pos = INIT;
+      old_occupied.reset (INIT);
+    }
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+void HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: ensure_buckets ()
 {
-  if (mult == 0){
+  if (_capacity == INIT)
+    {
       delete[] buckets;
-      auto *new_buckets = new bucket[ERASE_LAST_INIT];
+      _capacity = std::max (INIT_CAPACITY, _min_capacity);
+      buckets = new bucket[_capacity];
+      occupied.reset (_capacity);
+    }
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+void HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: finish_migration
+    ()
+{
+  while (old_buckets)
+    {
+      migrate_step ();
+    }
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+void HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: resize
+    (int new_capacity)
+{
+  // A resize during a resize (e.g. a burst of erases right after a grow)
+  // first completes the previous one
+  finish_migration ();
+  if (_size == INIT){
+      delete[] buckets;
+      auto *new_buckets = new bucket[new_capacity];
       buckets=new_buckets;
-      _capacity=ERASE_LAST_INIT;
+      _capacity=new_capacity;
+      occupied.reset (_capacity);
+  }
+  else if (_incremental){
+      old_buckets = buckets;
+      _old_capacity = _capacity;
+      _migrate_pos = INIT;
+      _capacity = new_capacity;
+      buckets = new bucket[_capacity];
+      std::swap (old_occupied, occupied);
+      occupied.reset (_capacity);
+      migrate_step ();
   }
   else{
-      auto *new_buckets = new bucket[(int)(_capacity * mult)];
-      for (int i=0; i<capacity();i++){
-          for (const auto& it : buckets[i]){
-              new_buckets[hash_func (it.first)].push_back(it);
+      auto *new_buckets = new bucket[new_capacity];
+      BucketBitmap new_occupied;
+      new_occupied.reset (new_capacity);
+      // Only the non-empty buckets are visited
+      for (int i = occupied.next (0); i != -1; i = occupied.next (i + 1)){
+          for (int j = 0; j < buckets[i].size (); j++){
+              size_t hash = hash_at (buckets[i], j);
+              int new_ind = bucket_of (hash, new_capacity);
+              new_buckets[new_ind].emplace_back
+              (hash, std::move (buckets[i][j]));
+              new_occupied.set (new_ind);
             }
         }
       delete[] buckets;
-      _capacity *= mult;
+      _capacity = new_capacity;
       buckets = new_buckets;
+      occupied = std::move (new_occupied);
   }
 }
 
-template<class KeyT, class ValueT>
-void HashMap<KeyT,ValueT>:: update_capacity (bool is_grow)
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+void HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: update_capacity
+    (bool is_grow)
 {
-  double mult;
+  int new_capacity;
   if (is_grow)
     {
-      if (get_load_factor () > LOAD_FACTOR_MAX){
-          mult = MULT;
+      if (get_load_factor () > _max_load){
+          new_capacity = grown_capacity (_capacity);
       }
       else{
           return;
@@ -521,42 +2072,304 @@ void HashMap<KeyT,ValueT>:: update_capacity (bool is_grow)
     {
       if (_size == INIT)
         {
-          mult = ERASE_LAST_INDICATION;
+          new_capacity = ERASE_LAST_INIT;
         }
-      else if (get_load_factor () < LOAD_FACTOR_MIN)
+      else if (get_load_factor () < _min_load)
         {
-          mult = DIV;
+          new_capacity = (int) (_capacity * DIV);
         }
       else{
           return;
       }
+      new_capacity = std::max (new_capacity, _min_capacity);
+      if (new_capacity >= _capacity)
+        {
+          return;
+        }
+    }
+  resize (new_capacity);
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+int HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: capacity_for
+    (long long n) const
+{
+  int new_capacity = _min_capacity;
+  while (n > new_capacity * _max_load)
+    {
+      new_capacity = grown_capacity (new_capacity);
+    }
+  return new_capacity;
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+int HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: grown_capacity
+    (long long capacity)
+{
+  long long new_capacity = capacity * MULT;
+  if (new_capacity > INT_MAX)
+    {
+      throw std::length_error (TOO_MANY_BUCKETS);
+    }
+  return (int) new_capacity;
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+int HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: shrunk_capacity
+    () const
+{
+  if (_size == INIT)
+    {
+      return std::min (_capacity, std::max (ERASE_LAST_INIT, _min_capacity));
+    }
+  int new_capacity = _capacity;
+  while (new_capacity > _min_capacity
+         && (double) _size / new_capacity < _min_load)
+    {
+      new_capacity = (int) (new_capacity * DIV);
+    }
+  return std::max (new_capacity, _min_capacity);
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+void HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: reserve (int n)
+{
+  ensure_buckets ();
+  int new_capacity = capacity_for (n);
+  if (new_capacity > _capacity)
+    {
+      resize (new_capacity);
+    }
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+void HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: rehash (int n)
+{
+  if (n < 0)
+    {
+      throw std::invalid_argument (INVALID_MSG);
+    }
+  ensure_buckets ();
+  int new_capacity = capacity_for (_size);
+  while (new_capacity < n)
+    {
+      new_capacity = grown_capacity (new_capacity);
+    }
+  if (new_capacity != _capacity)
+    {
+      resize (new_capacity);
+    }
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+void HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: shrink_to_fit ()
+{
+  rehash (INIT);
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+void HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: set_min_capacity
+    (int n)
+{
+  if (n <= INIT)
+    {
+      throw std::invalid_argument (INVALID_MSG);
+    }
+  int new_min = ERASE_LAST_INIT;
+  while (new_min < n)
+    {
+      new_min = grown_capacity (new_min);
+    }
+  _min_capacity = new_min;
+  reserve (INIT);
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+void HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: set_load_factors
+    (double max_load, double min_load)
+{
+  if (!(max_load > INIT) || !(min_load >= INIT)
+      || !(min_load * MULT < max_load))
+    {
+      throw std::invalid_argument (INVALID_MSG);
     }
-  rehash (mult);
+  _max_load = max_load;
+  _min_load = min_load;
+  reserve (_size);
 }
 
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+int HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: next_occupied
+    (int ind) const
+{
+  if (ind < _capacity)
+    {
+      int next = occupied.next (ind);
+      if (next != -1)
+        {
+          return next;
+        }
+      ind = _capacity;
+    }
+  if (old_buckets)
+    {
+      int next = old_occupied.next (ind - _capacity);
+      if (next != -1)
+        {
+          return _capacity + next;
+        }
+    }
+  return bucket_total ();
+}
 
-template<class KeyT, class ValueT>
-HashMap<KeyT,ValueT>:: ConstIterator:: ConstIterator
-(const HashMap<KeyT, ValueT>& hash_map, bool is_begin)
-: hash_map (hash_map)
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+void
+HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: rebuild_occupied ()
+{
+  occupied.reset (_capacity);
+  for (int i = 0; i < _capacity; i++)
     {
-        if (!is_begin)
+      if (!buckets[i].empty ())
         {
-          bucket_ind = hash_map.capacity ();
-          pair_ind = INIT;
-          return;
+          occupied.set (i);
         }
-        for (int i = 0; i < hash_map.capacity (); i++)
+    }
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+template<class KeyFn, class ValueFn>
+void HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: bulk_assign
+    (int n, KeyFn key_fn, ValueFn value_fn, int num_threads)
+{
+  ensure_buckets ();
+  finish_migration ();
+  // Sequential inserts would only grow from here, to fit the unique keys
+  int start_capacity = _capacity;
+  reserve (_size + n);
+  num_threads = std::max (1, std::min (num_threads,
+                                       n / BULK_MIN_PER_THREAD));
+
+  // Hash every key and count, per chunk of the input, how many pairs go
+  // to every partition (a contiguous range of buckets)
+  std::vector<size_t> hashes (n);
+  std::vector<int> counts ((size_t) num_threads * num_threads, INIT);
+  auto chunk_begin = [n, num_threads] (int t)
+  { return (int) ((long long) n * t / num_threads); };
+  auto partition_of = [this, num_threads] (size_t hash)
+  {
+    return (int) ((long long) bucket_of (hash, _capacity) * num_threads
+                  / _capacity);
+  };
+  run_parallel (num_threads, [&] (int t)
+  {
+    for (int i = chunk_begin (t); i < chunk_begin (t + 1); i++)
+      {
+        hashes[i] = full_hash (key_fn (i));
+        counts[t * num_threads + partition_of (hashes[i])]++;
+      }
+  });
+
+  // Scatter input indexes into partitions, keeping input order in each
+  std::vector<int> order (n);
+  std::vector<int> offsets (counts.size ());
+  int offset = INIT;
+  for (int p = 0; p < num_threads; p++)
+    {
+      for (int t = 0; t < num_threads; t++)
         {
-          if (!hash_map.buckets[i].empty ())
-            {
-              bucket_ind = i;
-              pair_ind = INIT;
-              return;
-            }
+          offsets[t * num_threads + p] = offset;
+          offset += counts[t * num_threads + p];
         }
-        bucket_ind = hash_map.capacity ();
-        pair_ind = INIT;
     }
+  std::vector<int> partition_begin (num_threads + 1, n);
+  for (int p = 0; p < num_threads; p++)
+    {
+      partition_begin[p] = offsets[p];
+    }
+  run_parallel (num_threads, [&] (int t)
+  {
+    int *next = &offsets[t * num_threads];
+    for (int i = chunk_begin (t); i < chunk_begin (t + 1); i++)
+      {
+        order[next[partition_of (hashes[i])]++] = i;
+      }
+  });
+
+  // Fill: a duplicate key always lands in the same partition, where the
+  // later index is applied later
+  std::vector<int> added (num_threads, INIT);
+  std::vector<uint64_t> added_prints (num_threads, INIT);
+  auto count_added = [this, &added, &added_prints] ()
+  {
+    for (int p = 0; p < (int) added.size (); p++)
+      {
+        _size += added[p];
+        _fingerprint += added_prints[p];
+      }
+  };
+  try
+    {
+      run_parallel (num_threads, [&] (int p)
+      {
+        for (int j = partition_begin[p]; j < partition_begin[p + 1]; j++)
+          {
+            int i = order[j];
+            bucket &key_bucket = buckets[bucket_of (hashes[i], _capacity)];
+            int ind = find_in (key_bucket, key_fn (i), hashes[i]);
+            if (ind != -1)
+              {
+                key_bucket[ind].second = value_fn (i);
+              }
+            else
+              {
+                key_bucket.emplace_back (hashes[i], key_fn (i), value_fn (i));
+                added[p]++;
+                added_prints[p] += key_print (hashes[i]);
+              }
+          }
+      });
+    }
+  catch (...)
+    {
+      count_added (); // keep _size true to the pairs that were placed
+      rebuild_occupied ();
+      throw;
+    }
+  count_added ();
+  rebuild_occupied ();
+
+  // Duplicate keys may leave the presized table larger than needed
+  int final_capacity = start_capacity;
+  while (_size > final_capacity * _max_load)
+    {
+      final_capacity = grown_capacity (final_capacity);
+    }
+  if (final_capacity < _capacity)
+    {
+      resize (final_capacity);
+    }
+}
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: ConstIterator::
+ConstIterator
+(const HashMap& hash_map, bool is_begin)
+: pair_ind (INIT), hash_map (&hash_map)
+{
+  bucket_ind = is_begin ? hash_map.next_occupied (INIT)
+                        : hash_map.bucket_total ();
+}
 
 #endif
@@ -0,0 +1,189 @@
+#ifndef KEYSEARCH_EX6
+#define KEYSEARCH_EX6
+
+#include <type_traits>
+#if defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define KEY_SEARCH_SIMD 1
+#endif
+
+/**
+ * Vectorized search of one integral key in a contiguous array of keys.
+ * find_key compares 16 / sizeof (KeyT) keys per SSE2 instruction, or twice
+ * as many with AVX2 when the running CPU has it (checked once, by CPUID).
+ * Other targets and compilers use the scalar loop.
+ */
+
+/**
+ * Scalar search
+ * @return index of the first key equal to key, or -1
+ */
+template<class KeyT>
+int find_key_scalar (const KeyT *keys, int n, KeyT key)
+{
+  for (int i = 0; i < n; i++)
+    {
+      if (keys[i] == key)
+        {
+          return i;
+        }
+    }
+  return -1;
+}
+
+#ifdef KEY_SEARCH_SIMD
+
+// Lane helpers, selected by key size
+template<int Size> using key_size = std::integral_constant<int, Size>;
+
+inline __m128i splat128 (char key, key_size<1>)
+{ return _mm_set1_epi8 (key); }
+inline __m128i splat128 (short key, key_size<2>)
+{ return _mm_set1_epi16 (key); }
+inline __m128i splat128 (int key, key_size<4>)
+{ return _mm_set1_epi32 (key); }
+inline __m128i splat128 (long long key, key_size<8>)
+{ return _mm_set1_epi64x (key); }
+
+inline __m128i cmpeq128 (__m128i a, __m128i b, key_size<1>)
+{ return _mm_cmpeq_epi8 (a, b); }
+inline __m128i cmpeq128 (__m128i a, __m128i b, key_size<2>)
+{ return _mm_cmpeq_epi16 (a, b); }
+inline __m128i cmpeq128 (__m128i a, __m128i b, key_size<4>)
+{ return _mm_cmpeq_epi32 (a, b); }
+inline __m128i cmpeq128 (__m128i a, __m128i b, key_size<8>)
+{
+  // SSE2 has no 64-bit compare: both 32-bit halves must match
+  __m128i eq = _mm_cmpeq_epi32 (a, b);
+  return _mm_and_si128 (eq, _mm_shuffle_epi32 (eq, _MM_SHUFFLE (2, 3, 0, 1)));
+}
+
+__attribute__ ((target ("avx2")))
+inline __m256i splat256 (char key, key_size<1>)
+{ return _mm256_set1_epi8 (key); }
+__attribute__ ((target ("avx2")))
+inline __m256i splat256 (short key, key_size<2>)
+{ return _mm256_set1_epi16 (key); }
+__attribute__ ((target ("avx2")))
+inline __m256i splat256 (int key, key_size<4>)
+{ return _mm256_set1_epi32 (key); }
+__attribute__ ((target ("avx2")))
+inline __m256i splat256 (long long key, key_size<8>)
+{ return _mm256_set1_epi64x (key); }
+
+__attribute__ ((target ("avx2")))
+inline __m256i cmpeq256 (__m256i a, __m256i b, key_size<1>)
+{ return _mm256_cmpeq_epi8 (a, b); }
+__attribute__ ((target ("avx2")))
+inline __m256i cmpeq256 (__m256i a, __m256i b, key_size<2>)
+{ return _mm256_cmpeq_epi16 (a, b); }
+__attribute__ ((target ("avx2")))
+inline __m256i cmpeq256 (__m256i a, __m256i b, key_size<4>)
+{ return _mm256_cmpeq_epi32 (a, b); }
+__attribute__ ((target ("avx2")))
+inline __m256i cmpeq256 (__m256i a, __m256i b, key_size<8>)
+{ return _mm256_cmpeq_epi64 (a, b); }
+
+/**
+ * Signed integer of the key's size, the lane type of the splat helpers
+ */
+template<class KeyT>
+using key_lane = typename std::conditional<sizeof (KeyT) == 1, char,
+    typename std::conditional<sizeof (KeyT) == 2, short,
+        typename std::conditional<sizeof (KeyT) == 4, int,
+            long long>::type>::type>::type;
+
+/**
+ * SSE2 search, 16 bytes of keys per compare
+ */
+template<class KeyT>
+int find_key_sse2 (const KeyT *keys, int n, KeyT key)
+{
+  const int lanes = 16 / sizeof (KeyT);
+  key_size<sizeof (KeyT)> size;
+  __m128i needle = splat128 ((key_lane<KeyT>) key, size);
+  int i = 0;
+  for (; i + lanes <= n; i += lanes)
+    {
+      __m128i block = _mm_loadu_si128 ((const __m128i *) (keys + i));
+      int mask = _mm_movemask_epi8 (cmpeq128 (block, needle, size));
+      if (mask)
+        {
+          return i + __builtin_ctz (mask) / (int) sizeof (KeyT);
+        }
+    }
+  for (; i < n; i++)
+    {
+      if (keys[i] == key)
+        {
+          return i;
+        }
+    }
+  return -1;
+}
+
+/**
+ * AVX2 search, 32 bytes of keys per compare
+ */
+template<class KeyT>
+__attribute__ ((target ("avx2")))
+int find_key_avx2 (const KeyT *keys, int n, KeyT key)
+{
+  const int lanes = 32 / sizeof (KeyT);
+  key_size<sizeof (KeyT)> size;
+  __m256i needle = splat256 ((key_lane<KeyT>) key, size);
+  int i = 0;
+  for (; i + lanes <= n; i += lanes)
+    {
+      __m256i block = _mm256_loadu_si256 ((const __m256i *) (keys + i));
+      unsigned mask = (unsigned) _mm256_movemask_epi8
+          (cmpeq256 (block, needle, size));
+      if (mask)
+        {
+          return i + __builtin_ctz (mask) / (int) sizeof (KeyT);
+        }
+    }
+  for (; i < n; i++)
+    {
+      if (keys[i] == key)
+        {
+          return i;
+        }
+    }
+  return -1;
+}
+
+/**
+ * Whether the running CPU supports AVX2 (CPUID, checked once)
+ */
+inline bool cpu_has_avx2 ()
+{
+  static const bool has_avx2 = __builtin_cpu_supports ("avx2");
+  return has_avx2;
+}
+
+#endif //KEY_SEARCH_SIMD
+
+/**
+ * Find Key Function
+ * @tparam KeyT integral type of 1, 2, 4 or 8 bytes
+ * @param keys array of n keys
+ * @param n
+ * @param key
+ * @return index of the first key equal to key, or -1
+ */
+template<class KeyT>
+int find_key (const KeyT *keys, int n, KeyT key)
+{
+  static_assert (std::is_integral<KeyT>::value, "find_key needs integral keys");
+#ifdef KEY_SEARCH_SIMD
+  if (n >= (int) (16 / sizeof (KeyT)))
+    {
+      return cpu_has_avx2 () ? find_key_avx2 (keys, n, key)
+                             : find_key_sse2 (keys, n, key);
+    }
+#endif
+  return find_key_scalar (keys, n, key);
+}
+
+#endif //KEYSEARCH_EX6
@@ -0,0 +1,512 @@
+#ifndef ORDEREDHASHMAP_EX6
+#define ORDEREDHASHMAP_EX6
+
+#include "HashMap.hpp"
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#define SLOT_EMPTY UINT32_MAX
+#define SLOT_DELETED (UINT32_MAX - 1)
+#define ENTRY_ERASED SIZE_MAX
+#define ORDERED_MAX_LOAD_NUM 2
+#define ORDERED_MAX_LOAD_DEN 3
+
+/**
+ * OrderedHashMap class
+ * Compact, insertion-ordered hash map (the layout of CPython's dict).
+ * Pairs live in one dense vector in insertion order; the hash table itself
+ * is an open-addressing array of 32-bit indexes into that vector. Iteration
+ * is a linear scan of contiguous pairs, and the table costs 4 bytes a slot.
+ * Erase leaves a hole in the pairs, which are compacted in one batch once
+ * the holes outnumber the live pairs, so erase stays O(1) amortized and
+ * the remaining pairs keep their order.
+ * @tparam KeyT
+ * @tparam ValueT
+ */
+template<class KeyT, class ValueT>
+class OrderedHashMap {
+
+  // Private Members
+  typedef std::pair<KeyT, ValueT> entry_type;
+  std::vector<entry_type> entries; // Pairs in insertion order, with holes
+  std::vector<size_t> hashes; // Hash of every entry, ENTRY_ERASED for holes
+  std::vector<uint32_t> slots; // Index into entries, power of 2 of them
+  int _size = INIT; // Num of live pairs
+
+  // Private helper functions
+
+  /**
+   * Full hash of a key. The top bit is always clear, so no key hashes to
+   * ENTRY_ERASED.
+   */
+  static size_t hash_key (const KeyT &key)
+  { return hash_mix (std::hash<KeyT>{} (key)) >> HASH_HELP; }
+
+  /**
+   * Find the slot that points to the entry of key
+   * @return index of slot, or -1 if key does not exist
+   */
+  int find_slot (const KeyT &key, size_t hash) const;
+
+  /**
+   * Find the entry of key
+   * @return index of entry, or -1 if key does not exist
+   */
+  int find_entry (const KeyT &key, size_t hash) const
+  {
+    int slot = find_slot (key, hash);
+    return slot == -1 ? -1 : (int) slots[slot];
+  }
+
+  /**
+   * Append a pair whose key is known to be absent, compacting or growing
+   * the table first if every slot a new entry may take is used
+   * @return index of the new entry
+   */
+  template<class... Args>
+  int append (size_t hash, Args &&... args);
+
+  /**
+   * Drop the holes from entries and rebuild the slots, enough of them (and
+   * at least INIT_CAPACITY) to keep the load factor of fit pairs at 1 / 3
+   * @param fit number of pairs to size the slots for, at least size ()
+   */
+  void compact (int fit);
+
+  int holes () const { return (int) entries.size () - _size; }
+
+ public:
+  // Constructors
+  OrderedHashMap () : slots (INIT_CAPACITY, SLOT_EMPTY) {} // Default
+
+  /**
+   * Main Constructor
+   * Gets a vector of KeyT type and a vector of ValueT type and inserts the
+   * key-value pairs by order, later values overwrite earlier ones (but keep
+   * the position of the first)
+   * @param keyVec
+   * @param valVec
+   */
+  OrderedHashMap (const std::vector<KeyT> &keyVec,
+                  const std::vector<ValueT> &valVec);
+
+  // Getters and Checkers
+  int size () const { return _size; }
+  int capacity () const { return (int) slots.size (); }
+  double get_load_factor () const
+  { return capacity () ? (double) _size / capacity () : INIT; }
+  bool contains_key (const KeyT &key) const
+  { return find_slot (key, hash_key (key)) != -1; }
+  bool empty () const { return _size == INIT; }
+
+  // Operations
+
+  /**
+   * Insert Function
+   * Appends a pair of key-value, if map does not contain key
+   * @param key
+   * @param value
+   * @return true upon success
+   */
+  bool insert (const KeyT &key, const ValueT &value);
+  bool insert (KeyT &&key, ValueT &&value); // moves both into the map
+
+  /**
+   * Erase pair, the others keep their order
+   * @param key
+   * @return true upon success of operation
+   */
+  virtual bool erase (const KeyT &key);
+
+  /**
+   * Clear all pairs, capacity stays the same
+   */
+  void clear ();
+
+  /**
+   * Reserve Function
+   * Sizes the pairs and the table so n pairs fit without a rebuild
+   * @param n
+   */
+  void reserve (int n);
+
+  /**
+   * Shrink To Fit Function
+   * Compacts now, instead of waiting for enough erases
+   */
+  void shrink_to_fit () { compact (_size); }
+
+  // Copy and Move, a moved-from map is empty and usable
+  OrderedHashMap (const OrderedHashMap &other) = default;
+  OrderedHashMap &operator= (const OrderedHashMap &other) = default;
+  OrderedHashMap (OrderedHashMap &&other) noexcept
+      : entries (std::move (other.entries)), hashes (std::move (other.hashes)),
+        slots (std::move (other.slots)), _size (other._size)
+  { other._size = INIT; }
+  OrderedHashMap &operator= (OrderedHashMap &&other) noexcept
+  {
+    std::swap (entries, other.entries);
+    std::swap (hashes, other.hashes);
+    std::swap (slots, other.slots);
+    std::swap (_size, other._size);
+    return *this;
+  }
+  virtual ~OrderedHashMap () = default;
+
+  // Operators
+
+  /**
+   * At operator
+   * Raises exceptions if does not exist
+   * @param key
+   * @return ValueT if exists
+   */
+  ValueT &at (const KeyT &key);
+  const ValueT &at (const KeyT &key) const; // const version
+
+  /**
+   * Operator []
+   * Appends a default ValueT if key does not exist
+   * @param key
+   * @return ValueT
+   */
+  ValueT &operator[] (const KeyT &key);
+  const ValueT &operator[] (const KeyT &key) const { return at (key); }
+
+  /**
+   * Try Get Function
+   * @param key
+   * @return pointer to the value of key, or nullptr if key does not exist
+   */
+  ValueT *try_get (const KeyT &key);
+  const ValueT *try_get (const KeyT &key) const;
+
+  /**
+   * Operator ==
+   * @param other
+   * @return true if both maps hold the same pairs, in any order
+   */
+  bool operator== (const OrderedHashMap &other) const;
+  bool operator!= (const OrderedHashMap &other) const
+  { return !(operator== (other)); }
+
+  // Begin & End functions, iteration is in insertion order
+  class ConstIterator;
+  using const_iterator = ConstIterator;
+  const_iterator begin () const { return ConstIterator (*this, 0); }
+  const_iterator cbegin () const { return begin (); }
+  const_iterator end () const
+  { return ConstIterator (*this, (int) entries.size ()); }
+  const_iterator cend () const { return end (); }
+
+  // Nested class - ConstIterator
+  class ConstIterator {
+    // Privates
+    int entry_ind; // Index of a live entry, or entries.size () at the end
+    const OrderedHashMap<KeyT, ValueT> *ordered_map; // map to iterate on
+
+    /**
+     * Move entry_ind forward to the first live entry at or after it
+     */
+    void skip_holes ()
+    {
+      while (entry_ind < (int) ordered_map->entries.size ()
+             && ordered_map->hashes[entry_ind] == ENTRY_ERASED)
+        {
+          entry_ind++;
+        }
+    }
+
+   public:
+    // Iterator traits:
+    typedef std::pair<KeyT, ValueT> value_type;
+    typedef const value_type &reference;
+    typedef const value_type *pointer;
+    typedef std::ptrdiff_t difference_type;
+    typedef std::forward_iterator_tag iterator_category;
+
+    /**
+     * Constructor
+     * @param ordered_map
+     * @param start first entry index to consider
+     */
+    ConstIterator (const OrderedHashMap<KeyT, ValueT> &ordered_map,
+                   int start)
+        : entry_ind (start), ordered_map (&ordered_map)
+    { skip_holes (); }
+
+    ConstIterator &operator++ ()
+    {
+      entry_ind++;
+      skip_holes ();
+      return *this;
+    }
+
+    ConstIterator operator++ (int)
+    {
+      ConstIterator tmp_it (*this);
+      ++(*this);
+      return tmp_it;
+    }
+
+    bool operator== (const ConstIterator &rhs) const
+    { return ordered_map == rhs.ordered_map && entry_ind == rhs.entry_ind; }
+
+    bool operator!= (const ConstIterator &rhs) const
+    { return !(*this == rhs); }
+
+    // Access operators
+    reference operator* () const
+    { return ordered_map->entries[entry_ind]; }
+    pointer operator-> () const { return &(operator* ()); }
+  };
+};
+
+template<class KeyT, class ValueT>
+int OrderedHashMap<KeyT, ValueT>:: find_slot (const KeyT &key,
+                                              size_t hash) const
+{
+  if (slots.empty ())
+    {
+      return -1; // moved-from map
+    }
+  size_t mask = slots.size () - HASH_HELP;
+  for (size_t slot = hash & mask;; slot = (slot + 1) & mask)
+    {
+      uint32_t entry = slots[slot];
+      if (entry == SLOT_EMPTY)
+        {
+          return -1;
+        }
+      if (entry != SLOT_DELETED && hashes[entry] == hash
+          && entries[entry].first == key)
+        {
+          return (int) slot;
+        }
+    }
+}
+
+template<class KeyT, class ValueT>
+template<class... Args>
+int OrderedHashMap<KeyT, ValueT>:: append (size_t hash, Args &&... args)
+{
+  // Every entry, live or a hole, took one slot since the last compaction
+  if ((entries.size () + 1) * ORDERED_MAX_LOAD_DEN
+      > slots.size () * ORDERED_MAX_LOAD_NUM)
+    {
+      compact (_size);
+    }
+  entries.emplace_back (std::forward<Args> (args)...);
+  try
+    {
+      hashes.push_back (hash);
+    }
+  catch (...)
+    {
+      entries.pop_back ();
+      throw;
+    }
+  size_t mask = slots.size () - HASH_HELP;
+  size_t slot = hash & mask;
+  while (slots[slot] != SLOT_EMPTY)
+    {
+      slot = (slot + 1) & mask;
+    }
+  int ind = (int) entries.size () - 1;
+  slots[slot] = (uint32_t) ind;
+  _size++;
+  return ind;
+}
+
+template<class KeyT, class ValueT>
+void OrderedHashMap<KeyT, ValueT>:: compact (int fit)
+{
+  if (holes ())
+    {
+      int live = 0;
+      for (int i = 0; i < (int) entries.size (); i++)
+        {
+          if (hashes[i] != ENTRY_ERASED)
+            {
+              if (i != live)
+                {
+                  entries[live] = std::move (entries[i]);
+                  hashes[live] = hashes[i];
+                }
+              live++;
+            }
+        }
+      entries.erase (entries.begin () + live, entries.end ());
+      hashes.resize (live);
+    }
+  size_t new_capacity = INIT_CAPACITY;
+  while ((size_t) (fit + 1) * ORDERED_MAX_LOAD_DEN > new_capacity)
+    {
+      new_capacity *= MULT;
+    }
+  slots.assign (new_capacity, SLOT_EMPTY);
+  size_t mask = new_capacity - HASH_HELP;
+  for (int i = 0; i < (int) entries.size (); i++)
+    {
+      size_t slot = hashes[i] & mask;
+      while (slots[slot] != SLOT_EMPTY)
+        {
+          slot = (slot + 1) & mask;
+        }
+      slots[slot] = (uint32_t) i;
+    }
+}
+
+template<class KeyT, class ValueT>
+OrderedHashMap<KeyT, ValueT>:: OrderedHashMap
+    (const std::vector<KeyT> &keyVec, const std::vector<ValueT> &valVec)
+    : OrderedHashMap ()
+{
+  if (keyVec.size () != valVec.size ())
+    {
+      throw std::length_error (VECTOR_LENGTH);
+    }
+  reserve ((int) keyVec.size ());
+  for (int i = 0; i < (int) keyVec.size (); i++)
+    {
+      (*this)[keyVec[i]] = valVec[i];
+    }
+}
+
+template<class KeyT, class ValueT>
+bool OrderedHashMap<KeyT, ValueT>:: insert (const KeyT &key,
+                                            const ValueT &value)
+{
+  size_t hash = hash_key (key);
+  if (find_slot (key, hash) != -1)
+    {
+      return false;
+    }
+  append (hash, key, value);
+  return true;
+}
+
+template<class KeyT, class ValueT>
+bool OrderedHashMap<KeyT, ValueT>:: insert (KeyT &&key, ValueT &&value)
+{
+  size_t hash = hash_key (key);
+  if (find_slot (key, hash) != -1)
+    {
+      return false;
+    }
+  append (hash, std::move (key), std::move (value));
+  return true;
+}
+
+template<class KeyT, class ValueT>
+bool OrderedHashMap<KeyT, ValueT>:: erase (const KeyT &key)
+{
+  int slot = find_slot (key, hash_key (key));
+  if (slot == -1)
+    {
+      return false;
+    }
+  hashes[slots[slot]] = ENTRY_ERASED;
+  slots[slot] = SLOT_DELETED;
+  _size--;
+  if (holes () > _size)
+    {
+      compact (_size);
+    }
+  return true;
+}
+
+template<class KeyT, class ValueT>
+void OrderedHashMap<KeyT, ValueT>:: clear ()
+{
+  entries.clear ();
+  hashes.clear ();
+  slots.assign (slots.size (), SLOT_EMPTY);
+  _size = INIT;
+}
+
+template<class KeyT, class ValueT>
+void OrderedHashMap<KeyT, ValueT>:: reserve (int n)
+{
+  if (n <= _size)
+    {
+      return;
+    }
+  entries.reserve (n + holes ());
+  hashes.reserve (n + holes ());
+  if ((size_t) n * ORDERED_MAX_LOAD_DEN > slots.size () * ORDERED_MAX_LOAD_NUM)
+    {
+      compact (n);
+    }
+}
+
+template<class KeyT, class ValueT>
+ValueT &OrderedHashMap<KeyT, ValueT>:: at (const KeyT &key)
+{
+  int ind = find_entry (key, hash_key (key));
+  if (ind == -1)
+    {
+      throw std::invalid_argument (KEY_NOT_FOUND);
+    }
+  return entries[ind].second;
+}
+
+template<class KeyT, class ValueT>
+const ValueT &OrderedHashMap<KeyT, ValueT>:: at (const KeyT &key) const
+{
+  int ind = find_entry (key, hash_key (key));
+  if (ind == -1)
+    {
+      throw std::invalid_argument (KEY_NOT_FOUND);
+    }
+  return entries[ind].second;
+}
+
+template<class KeyT, class ValueT>
+ValueT &OrderedHashMap<KeyT, ValueT>:: operator[] (const KeyT &key)
+{
+  size_t hash = hash_key (key);
+  int ind = find_entry (key, hash);
+  if (ind == -1)
+    {
+      ind = append (hash, key, ValueT ());
+    }
+  return entries[ind].second;
+}
+
+template<class KeyT, class ValueT>
+ValueT *OrderedHashMap<KeyT, ValueT>:: try_get (const KeyT &key)
+{
+  int ind = find_entry (key, hash_key (key));
+  return ind == -1 ? nullptr : &entries[ind].second;
+}
+
+template<class KeyT, class ValueT>
+const ValueT *OrderedHashMap<KeyT, ValueT>:: try_get (const KeyT &key) const
+{
+  int ind = find_entry (key, hash_key (key));
+  return ind == -1 ? nullptr : &entries[ind].second;
+}
+
+template<class KeyT, class ValueT>
+bool OrderedHashMap<KeyT, ValueT>:: operator== (const OrderedHashMap &other)
+    const
+{
+  if (_size != other._size)
+    {
+      return false;
+    }
+  for (const auto &it : other)
+    {
+      const ValueT *value = try_get (it.first);
+      if (!value || *value != it.second)
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+#endif //ORDEREDHASHMAP_EX6
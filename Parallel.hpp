@@ -0,0 +1,200 @@
+#ifndef PARALLEL_EX6
+#define PARALLEL_EX6
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define CHUNKS_PER_THREAD 8
+#define CACHE_LINE_BYTES 64
+
+/**
+ * Number of threads to use by default: one per hardware thread
+ */
+inline int default_threads ()
+{
+  return std::max (1, (int) std::thread::hardware_concurrency ());
+}
+
+/**
+ * Run fn (0) ... fn (num_threads - 1), each on its own thread (fn (0) on
+ * the calling one), and rethrow the first exception any of them threw
+ * @param num_threads
+ * @param fn callable as fn (int thread)
+ */
+template<class Fn>
+void run_parallel (int num_threads, Fn fn)
+{
+  std::vector<std::exception_ptr> errors (num_threads);
+  std::vector<std::thread> threads;
+  auto guarded = [&fn, &errors] (int t)
+  {
+    try
+      {
+        fn (t);
+      }
+    catch (...)
+      {
+        errors[t] = std::current_exception ();
+      }
+  };
+  for (int t = 1; t < num_threads; t++)
+    {
+      threads.emplace_back (guarded, t);
+    }
+  guarded (0);
+  for (auto &thread : threads)
+    {
+      thread.join ();
+    }
+  for (auto &error : errors)
+    {
+      if (error)
+        {
+          std::rethrow_exception (error);
+        }
+    }
+}
+
+/**
+ * Run tasks 0 ... num_tasks - 1 on num_threads workers with work stealing.
+ * Every worker starts with its own contiguous share of the tasks and takes
+ * them from the front; a worker that runs out steals from the back of
+ * another worker's share, so a few slow tasks do not leave threads idle.
+ * After a task throws, no new task starts and the exception is rethrown.
+ * @param fn callable as fn (int task, int worker)
+ */
+template<class Fn>
+void run_work_stealing (int num_tasks, int num_threads, Fn fn)
+{
+  struct task_queue {
+      std::mutex lock;
+      std::deque<int> tasks;
+  };
+  num_threads = std::max (1, std::min (num_threads, num_tasks));
+  std::vector<task_queue> queues (num_threads);
+  for (int w = 0; w < num_threads; w++)
+    {
+      int first = (int) ((long long) num_tasks * w / num_threads);
+      int last = (int) ((long long) num_tasks * (w + 1) / num_threads);
+      for (int task = first; task < last; task++)
+        {
+          queues[w].tasks.push_back (task);
+        }
+    }
+  std::atomic<bool> failed (false);
+  auto next_task = [&queues, num_threads] (int w)
+  {
+    {
+      std::lock_guard<std::mutex> guard (queues[w].lock);
+      if (!queues[w].tasks.empty ())
+        {
+          int task = queues[w].tasks.front ();
+          queues[w].tasks.pop_front ();
+          return task;
+        }
+    }
+    for (int i = 1; i < num_threads; i++)
+      {
+        task_queue &victim = queues[(w + i) % num_threads];
+        std::lock_guard<std::mutex> guard (victim.lock);
+        if (!victim.tasks.empty ())
+          {
+            int task = victim.tasks.back ();
+            victim.tasks.pop_back ();
+            return task;
+          }
+      }
+    return -1;
+  };
+  run_parallel (num_threads, [&] (int w)
+  {
+    try
+      {
+        for (int task = next_task (w); task != -1 && !failed;
+             task = next_task (w))
+          {
+            fn (task, w);
+          }
+      }
+    catch (...)
+      {
+        failed = true;
+        throw;
+      }
+  });
+}
+
+/**
+ * Parallel For Each Function
+ * Calls fn on every pair of map, concurrently from up to num_threads
+ * threads. map must not change meanwhile.
+ * @tparam Map a map with ranges (n), such as HashMap
+ * @param fn callable as fn (const std::pair<KeyT, ValueT> &), safe to call
+ * concurrently
+ */
+template<class Map, class Fn>
+void parallel_for_each (const Map &map, Fn fn,
+                        int num_threads = default_threads ())
+{
+  auto ranges = map.ranges (num_threads * CHUNKS_PER_THREAD);
+  run_work_stealing ((int) ranges.size (), num_threads,
+                     [&ranges, &fn] (int task, int)
+  {
+    for (auto it = ranges[task].first; it != ranges[task].second; ++it)
+      {
+        fn (*it);
+      }
+  });
+}
+
+/**
+ * Parallel Reduce Function
+ * Folds the pairs of every task into a local accumulator, combined once
+ * into the result of its worker; the results of the workers sit at least
+ * a cache line apart, so workers never write to a shared line (nor to
+ * shared bits of a std::vector<bool>). Then combines the results of the
+ * workers. map must not change meanwhile.
+ * @tparam Map a map with ranges (n), such as HashMap
+ * @param identity initial value of every accumulator
+ * @param fn callable as fn (T accumulator, const std::pair<KeyT, ValueT> &)
+ * -> T
+ * @param combine callable as combine (T, T) -> T, associative and
+ * commutative (pairs reach the workers in no fixed order)
+ * @return the combined result, identity for an empty map
+ */
+template<class Map, class T, class Fn, class Combine>
+T parallel_reduce (const Map &map, T identity, Fn fn, Combine combine,
+                   int num_threads = default_threads ())
+{
+  struct padded_result {
+      T value;
+      char padding[CACHE_LINE_BYTES];
+  };
+  auto ranges = map.ranges (num_threads * CHUNKS_PER_THREAD);
+  std::vector<padded_result> results (std::max (1, num_threads),
+                                      padded_result {identity, {}});
+  run_work_stealing ((int) ranges.size (), num_threads,
+                     [&] (int task, int worker)
+  {
+    T partial = identity;
+    for (auto it = ranges[task].first; it != ranges[task].second; ++it)
+      {
+        partial = fn (std::move (partial), *it);
+      }
+    T &result = results[worker].value;
+    result = combine (std::move (result), std::move (partial));
+  });
+  T result = std::move (results[0].value);
+  for (int w = 1; w < (int) results.size (); w++)
+    {
+      result = combine (std::move (result), std::move (results[w].value));
+    }
+  return result;
+}
+
+#endif //PARALLEL_EX6
@@ -0,0 +1,537 @@
+#ifndef ROBINHOODHASHMAP_EX6
+#define ROBINHOODHASHMAP_EX6
+
+#include "HashMap.hpp"
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <utility>
+
+#define ROBIN_LOAD_FACTOR_MAX 0.9
+#define DIST_EMPTY 0
+
+/**
+ * RobinHoodHashMap class
+ * Open-addressing map with linear probing and Robin Hood displacement:
+ * on insert, a key that is further from its home slot takes the place of a
+ * key that is closer to its own, so probe lengths stay short and balanced.
+ * Erase shifts the following cluster one slot back instead of leaving a
+ * tombstone, so erase-heavy tables never degrade.
+ * A lookup stops as soon as it meets a key closer to home than the probe,
+ * which bounds a miss even when the table is full.
+ * @tparam KeyT
+ * @tparam ValueT
+ */
+template<class KeyT, class ValueT>
+class RobinHoodHashMap {
+
+  // Private Members
+  typedef std::pair<KeyT, ValueT> slot_type;
+  slot_type *slots; // Slot array, constructed only where dist != DIST_EMPTY
+  uint32_t *dist; // Probe distance + 1 of each slot, DIST_EMPTY if free
+  int _size = INIT; // Num of pairs in slot array
+  int _capacity = INIT_CAPACITY; // Num of slots, power of 2
+  double _max_load = ROBIN_LOAD_FACTOR_MAX;
+
+  // Private helper functions
+
+  /**
+   * Full hash of a key, mixed so identity hashes do not cluster
+   */
+  static size_t hash_key (const KeyT &key);
+
+  int home (size_t hash) const { return (int) (hash & (_capacity - 1)); }
+  int next (int ind) const { return (ind + 1) & (_capacity - 1); }
+
+  /**
+   * Find the slot holding key
+   * @return index of slot, or -1 if key does not exist
+   */
+  int find_index (const KeyT &key) const;
+
+  /**
+   * Place a pair whose key is known to be absent, without a load check
+   * @return index the new pair ended up in
+   */
+  int place (slot_type &&pair, size_t hash);
+
+  /**
+   * Insert a pair whose key is known to be absent, growing when needed
+   * @return index of the new pair
+   */
+  int insert_new (slot_type &&pair);
+
+  /**
+   * Allocate empty arrays of new_capacity slots and move every pair in
+   * @param new_capacity
+   */
+  void rehash (int new_capacity);
+
+  void allocate (int capacity);
+  void destroy ();
+
+ public:
+  // Constructors and Destructor
+  RobinHoodHashMap () { allocate (INIT_CAPACITY); } // Default
+
+  /**
+   * Main Constructor
+   * Gets a vector of KeyT type and a vector of ValueT type and inserts the
+   * key-value pairs by order, later values overwrite earlier ones
+   * @param keyVec
+   * @param valVec
+   */
+  RobinHoodHashMap (const std::vector<KeyT> &keyVec,
+                    const std::vector<ValueT> &valVec);
+
+  /**
+   * Copy Constructor
+   * @param other
+   */
+  RobinHoodHashMap (const RobinHoodHashMap<KeyT, ValueT> &other);
+
+  virtual ~RobinHoodHashMap () { destroy (); }
+
+  /**
+   * Operator=
+   * @param other
+   * @return a deep copy of other
+   */
+  RobinHoodHashMap &operator= (const RobinHoodHashMap<KeyT, ValueT> &other);
+
+  // Getters and Checkers
+  int size () const { return _size; }
+  int capacity () const { return _capacity; }
+  double get_load_factor () const { return (double) _size / _capacity; }
+  bool contains_key (const KeyT &key) const
+  { return find_index (key) != -1; }
+  bool empty () const { return _size == INIT; }
+
+  /**
+   * Longest probe sequence currently in the table (0 when every key sits in
+   * its home slot). Scans the whole table, meant for diagnostics.
+   */
+  int max_probe_length () const;
+
+  /**
+   * Set the load factor above which the table doubles
+   * Raises exception if not in (0, 1)
+   * @param max_load
+   */
+  void set_max_load_factor (double max_load);
+
+  // Operations
+
+  /**
+   * Insert Function
+   * Inserts a pair of key-value, if map does not contain key
+   * @param key
+   * @param value
+   * @return true upon success
+   */
+  bool insert (const KeyT &key, const ValueT &value);
+
+  /**
+   * Erase pair by backward shifting the rest of its cluster
+   * @param key
+   * @return true upon success of operation
+   */
+  virtual bool erase (const KeyT &key);
+
+  /**
+   * Clear all pairs, capacity stays the same
+   */
+  void clear ();
+
+  // Operators
+
+  /**
+   * At operator
+   * Raises exceptions if does not exist
+   * @param key
+   * @return ValueT if exists
+   */
+  ValueT &at (const KeyT &key);
+  const ValueT &at (const KeyT &key) const; // const version
+
+  /**
+   * Operator []
+   * Inserts a default ValueT if key does not exist
+   * @param key
+   * @return ValueT
+   */
+  ValueT &operator[] (const KeyT &key);
+  const ValueT &operator[] (const KeyT &key) const { return at (key); }
+
+  /**
+   * Operator ==
+   * @param other
+   * @return true if both maps hold the same pairs
+   */
+  bool operator== (const RobinHoodHashMap &other) const;
+  bool operator!= (const RobinHoodHashMap &other) const
+  { return !(operator== (other)); }
+
+  // Begin & End functions
+  class ConstIterator;
+  using const_iterator = ConstIterator;
+  const_iterator begin () const { return ConstIterator (*this, 0); }
+  const_iterator cbegin () const { return begin (); }
+  const_iterator end () const { return ConstIterator (*this, _capacity); }
+  const_iterator cend () const { return end (); }
+
+  // Nested class - ConstIterator
+  class ConstIterator {
+    // Privates
+    int slot_ind; // Index of a full slot, or capacity at the end
+    const RobinHoodHashMap<KeyT, ValueT> *robin_map; // map to iterate on
+
+    /**
+     * Move slot_ind forward to the first full slot at or after it
+     */
+    void skip_free ()
+    {
+      while (slot_ind < robin_map->_capacity
+             && robin_map->dist[slot_ind] == DIST_EMPTY)
+        {
+          slot_ind++;
+        }
+    }
+
+   public:
+    // Iterator traits:
+    typedef std::pair<KeyT, ValueT> value_type;
+    typedef const value_type &reference;
+    typedef const value_type *pointer;
+    typedef std::ptrdiff_t difference_type;
+    typedef std::forward_iterator_tag iterator_category;
+
+    /**
+     * Constructor
+     * @param robin_map
+     * @param start first slot index to consider
+     */
+    ConstIterator (const RobinHoodHashMap<KeyT, ValueT> &robin_map,
+                   int start)
+        : slot_ind (start), robin_map (&robin_map)
+    { skip_free (); }
+
+    ConstIterator &operator++ ()
+    {
+      slot_ind++;
+      skip_free ();
+      return *this;
+    }
+
+    ConstIterator operator++ (int)
+    {
+      ConstIterator tmp_it (*this);
+      ++(*this);
+      return tmp_it;
+    }
+
+    bool operator== (const ConstIterator &rhs) const
+    { return robin_map == rhs.robin_map && slot_ind == rhs.slot_ind; }
+
+    bool operator!= (const ConstIterator &rhs) const
+    { return !(*this == rhs); }
+
+    // Access operators
+    reference operator* () const { return robin_map->slots[slot_ind]; }
+    pointer operator-> () const { return &(operator* ()); }
+  };
+};
+
+template<class KeyT, class ValueT>
+size_t RobinHoodHashMap<KeyT, ValueT>:: hash_key (const KeyT &key)
+{
+  return hash_mix (std::hash<KeyT>{} (key));
+}
+
+template<class KeyT, class ValueT>
+int RobinHoodHashMap<KeyT, ValueT>:: find_index (const KeyT &key) const
+{
+  int ind = home (hash_key (key));
+  // A key with a shorter distance than ours means ours would have
+  // displaced it, so the key cannot be further along
+  for (uint32_t d = 1; dist[ind] >= d; d++)
+    {
+      if (dist[ind] == d && slots[ind].first == key)
+        {
+          return ind;
+        }
+      ind = next (ind);
+    }
+  return -1;
+}
+
+template<class KeyT, class ValueT>
+int RobinHoodHashMap<KeyT, ValueT>:: place (slot_type &&pair, size_t hash)
+{
+  int ind = home (hash), placed = -1;
+  uint32_t d = 1;
+  slot_type carry (std::move (pair));
+  for (;;)
+    {
+      if (dist[ind] == DIST_EMPTY)
+        {
+          new (slots + ind) slot_type (std::move (carry));
+          dist[ind] = d;
+          return placed == -1 ? ind : placed;
+        }
+      if (dist[ind] < d)
+        {
+          // Rich slot: take it and carry its pair further
+          std::swap (carry, slots[ind]);
+          std::swap (d, dist[ind]);
+          if (placed == -1)
+            {
+              placed = ind;
+            }
+        }
+      ind = next (ind);
+      d++;
+    }
+}
+
+template<class KeyT, class ValueT>
+int RobinHoodHashMap<KeyT, ValueT>:: insert_new (slot_type &&pair)
+{
+  if (_size + 1 > _capacity * _max_load)
+    {
+      rehash (_capacity * MULT);
+    }
+  size_t hash = hash_key (pair.first);
+  _size++;
+  return place (std::move (pair), hash);
+}
+
+template<class KeyT, class ValueT>
+void RobinHoodHashMap<KeyT, ValueT>:: allocate (int capacity)
+{
+  _capacity = capacity;
+  slots = static_cast<slot_type *>
+  (::operator new (sizeof (slot_type) * (size_t) capacity));
+  dist = new uint32_t[capacity] ();
+  _size = INIT;
+}
+
+template<class KeyT, class ValueT>
+void RobinHoodHashMap<KeyT, ValueT>:: destroy ()
+{
+  for (int i = 0; i < _capacity; i++)
+    {
+      if (dist[i] != DIST_EMPTY)
+        {
+          slots[i].~slot_type ();
+        }
+    }
+  ::operator delete (slots);
+  delete[] dist;
+}
+
+template<class KeyT, class ValueT>
+void RobinHoodHashMap<KeyT, ValueT>:: rehash (int new_capacity)
+{
+  slot_type *old_slots = slots;
+  uint32_t *old_dist = dist;
+  int old_capacity = _capacity, old_size = _size;
+  allocate (new_capacity);
+  for (int i = 0; i < old_capacity; i++)
+    {
+      if (old_dist[i] == DIST_EMPTY)
+        {
+          continue;
+        }
+      size_t hash = hash_key (old_slots[i].first);
+      place (std::move (old_slots[i]), hash);
+      old_slots[i].~slot_type ();
+    }
+  _size = old_size;
+  ::operator delete (old_slots);
+  delete[] old_dist;
+}
+
+template<class KeyT, class ValueT>
+RobinHoodHashMap<KeyT, ValueT>:: RobinHoodHashMap
+    (const std::vector<KeyT> &keyVec, const std::vector<ValueT> &valVec)
+{
+  if (keyVec.size () != valVec.size ())
+    {
+      throw std::length_error (VECTOR_LENGTH);
+    }
+  int capacity = INIT_CAPACITY;
+  while (capacity * _max_load < (double) keyVec.size ())
+    {
+      capacity *= MULT;
+    }
+  allocate (capacity);
+  for (int i = 0; i < (int) keyVec.size (); i++)
+    {
+      (*this)[keyVec[i]] = valVec[i];
+    }
+}
+
+template<class KeyT, class ValueT>
+RobinHoodHashMap<KeyT, ValueT>:: RobinHoodHashMap
+    (const RobinHoodHashMap<KeyT, ValueT> &other)
+{
+  _max_load = other._max_load;
+  allocate (other._capacity);
+  for (int i = 0; i < _capacity; i++)
+    {
+      if (other.dist[i] != DIST_EMPTY)
+        {
+          new (slots + i) slot_type (other.slots[i]);
+        }
+    }
+  std::memcpy (dist, other.dist, sizeof (uint32_t) * (size_t) _capacity);
+  _size = other._size;
+}
+
+template<class KeyT, class ValueT>
+RobinHoodHashMap<KeyT, ValueT> &RobinHoodHashMap<KeyT, ValueT>:: operator=
+    (const RobinHoodHashMap<KeyT, ValueT> &other)
+{
+  if (this == &other)
+    {
+      return *this;
+    }
+  RobinHoodHashMap<KeyT, ValueT> copy (other);
+  std::swap (slots, copy.slots);
+  std::swap (dist, copy.dist);
+  std::swap (_size, copy._size);
+  std::swap (_capacity, copy._capacity);
+  std::swap (_max_load, copy._max_load);
+  return *this;
+}
+
+template<class KeyT, class ValueT>
+int RobinHoodHashMap<KeyT, ValueT>:: max_probe_length () const
+{
+  int longest = 0;
+  for (int i = 0; i < _capacity; i++)
+    {
+      longest = std::max (longest, (int) dist[i] - 1);
+    }
+  return longest;
+}
+
+template<class KeyT, class ValueT>
+void RobinHoodHashMap<KeyT, ValueT>:: set_max_load_factor (double max_load)
+{
+  if (max_load <= 0 || max_load >= 1)
+    {
+      throw std::invalid_argument (INVALID_MSG);
+    }
+  _max_load = max_load;
+  while (_size > _capacity * _max_load)
+    {
+      rehash (_capacity * MULT);
+    }
+}
+
+template<class KeyT, class ValueT>
+bool RobinHoodHashMap<KeyT, ValueT>:: insert (const KeyT &key,
+                                              const ValueT &value)
+{
+  if (find_index (key) != -1)
+    {
+      return false;
+    }
+  insert_new (slot_type (key, value));
+  return true;
+}
+
+template<class KeyT, class ValueT>
+bool RobinHoodHashMap<KeyT, ValueT>:: erase (const KeyT &key)
+{
+  int ind = find_index (key);
+  if (ind == -1)
+    {
+      return false;
+    }
+  // Shift the following cluster back until an empty slot or a key that
+  // already sits in its home slot
+  int following = next (ind);
+  while (dist[following] > 1)
+    {
+      slots[ind] = std::move (slots[following]);
+      dist[ind] = dist[following] - 1;
+      ind = following;
+      following = next (following);
+    }
+  slots[ind].~slot_type ();
+  dist[ind] = DIST_EMPTY;
+  --_size;
+  return true;
+}
+
+template<class KeyT, class ValueT>
+void RobinHoodHashMap<KeyT, ValueT>:: clear ()
+{
+  for (int i = 0; i < _capacity; i++)
+    {
+      if (dist[i] != DIST_EMPTY)
+        {
+          slots[i].~slot_type ();
+        }
+    }
+  std::fill (dist, dist + _capacity, (uint32_t) DIST_EMPTY);
+  _size = INIT;
+}
+
+template<class KeyT, class ValueT>
+ValueT &RobinHoodHashMap<KeyT, ValueT>:: at (const KeyT &key)
+{
+  int ind = find_index (key);
+  if (ind == -1)
+    {
+      throw std::invalid_argument (KEY_NOT_FOUND);
+    }
+  return slots[ind].second;
+}
+
+template<class KeyT, class ValueT>
+const ValueT &RobinHoodHashMap<KeyT, ValueT>:: at (const KeyT &key) const
+{
+  int ind = find_index (key);
+  if (ind == -1)
+    {
+      throw std::invalid_argument (KEY_NOT_FOUND);
+    }
+  return slots[ind].second;
+}
+
+template<class KeyT, class ValueT>
+ValueT &RobinHoodHashMap<KeyT, ValueT>:: operator[] (const KeyT &key)
+{
+  int ind = find_index (key);
+  if (ind != -1)
+    {
+      return slots[ind].second;
+    }
+  return slots[insert_new (slot_type (key, ValueT ()))].second;
+}
+
+template<class KeyT, class ValueT>
+bool RobinHoodHashMap<KeyT, ValueT>:: operator==
+    (const RobinHoodHashMap &other) const
+{
+  if (_size != other._size)
+    {
+      return false;
+    }
+  for (const auto &it : other)
+    {
+      int ind = find_index (it.first);
+      if (ind == -1 || slots[ind].second != it.second)
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+#endif //ROBINHOODHASHMAP_EX6
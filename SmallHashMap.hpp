@@ -0,0 +1,561 @@
+#ifndef SMALLHASHMAP_EX6
+#define SMALLHASHMAP_EX6
+
+#include "HashMap.hpp"
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+#define SMALL_INLINE_CAPACITY 8
+
+/**
+ * SmallHashMap class
+ * Map with inline storage for the common case of a few pairs. Up to N
+ * pairs live inside the object itself and are searched linearly, with no
+ * hashing and no heap allocation at all. Inserting pair N + 1 promotes the
+ * map to a heap HashMap; erasing back down to N / 2 pairs demotes it to the
+ * inline storage again (the gap keeps a map at the threshold from
+ * promoting and demoting on every insert/erase).
+ * @tparam KeyT
+ * @tparam ValueT
+ * @tparam N number of pairs kept inline
+ */
+template<class KeyT, class ValueT, int N = SMALL_INLINE_CAPACITY>
+class SmallHashMap {
+  static_assert (N > INIT, "SmallHashMap needs room for a pair inline");
+
+  // Private Members
+  typedef std::pair<KeyT, ValueT> pair_type;
+  typedef HashMap<KeyT, ValueT> table_type;
+  // Raw storage of the inline pairs, the first _small_size are constructed
+  alignas (pair_type) unsigned char storage[N * sizeof (pair_type)];
+  int _small_size = INIT;
+  std::unique_ptr<table_type> table; // The promoted map, null while inline
+  static const bool nothrow_move
+      = std::is_nothrow_move_constructible<pair_type>::value;
+
+  // Private helper functions
+
+  pair_type *inline_pairs ()
+  { return reinterpret_cast<pair_type *> (storage); }
+  const pair_type *inline_pairs () const
+  { return reinterpret_cast<const pair_type *> (storage); }
+
+  /**
+   * Find the inline pair of key
+   * @return index of pair, or -1 if key does not exist
+   */
+  int find_inline (const KeyT &key) const
+  {
+    for (int i = 0; i < _small_size; i++)
+      {
+        if (inline_pairs ()[i].first == key)
+          {
+            return i;
+          }
+      }
+    return -1;
+  }
+
+  /**
+   * Construct an inline pair whose key is known to be absent, promoting
+   * the map first if the inline storage is full
+   * @return the value of the new pair
+   */
+  template<class... Args>
+  ValueT &append (Args &&... args);
+
+  /**
+   * Copy the inline pairs into a new HashMap sized for N + 1 pairs, then
+   * destroy them: if the copy throws, the map is left as it was
+   */
+  void promote ();
+
+  /**
+   * Build the pairs of the HashMap inline and free it, size () <= N. The
+   * values are moved only if building a pair cannot throw, else copied,
+   * and the pairs are counted only once all are built: if a copy throws,
+   * the map stays promoted and unchanged.
+   */
+  void demote ();
+  static const ValueT &demoted_value (ValueT &value, std::false_type)
+  { return value; }
+  static ValueT &&demoted_value (ValueT &value, std::true_type)
+  { return std::move (value); }
+
+  /**
+   * Take the pairs of other, leaving it empty; this map must be empty
+   * and inline
+   */
+  void take (SmallHashMap &&other) noexcept (nothrow_move);
+
+  /**
+   * Destroy the inline pairs
+   */
+  void destroy_inline ();
+
+ public:
+  // Constructors and Destructor
+  SmallHashMap () = default; // Default, allocates nothing
+
+  /**
+   * Main Constructor
+   * Gets a vector of KeyT type and a vector of ValueT type and inserts the
+   * key-value pairs by order, later values overwrite earlier ones
+   * @param keyVec
+   * @param valVec
+   */
+  SmallHashMap (const std::vector<KeyT> &keyVec,
+                const std::vector<ValueT> &valVec);
+
+  // Copy and Move, a moved-from map is empty and usable
+  SmallHashMap (const SmallHashMap &other);
+  SmallHashMap (SmallHashMap &&other) noexcept (nothrow_move)
+  { take (std::move (other)); }
+  SmallHashMap &operator= (const SmallHashMap &other);
+  SmallHashMap &operator= (SmallHashMap &&other) noexcept (nothrow_move)
+  {
+    if (this != &other)
+      {
+        clear ();
+        take (std::move (other));
+      }
+    return *this;
+  }
+  virtual ~SmallHashMap () { destroy_inline (); }
+
+  // Getters and Checkers
+  int size () const { return table ? table->size () : _small_size; }
+  int capacity () const { return table ? table->capacity () : N; }
+  bool empty () const { return size () == INIT; }
+  bool contains_key (const KeyT &key) const { return try_get (key); }
+
+  /**
+   * Whether the pairs are inline, that is the map holds no heap memory
+   */
+  bool is_small () const { return !table; }
+
+  // Operations
+
+  /**
+   * Insert Function
+   * Inserts a pair of key-value, if map does not contain key
+   * @param key
+   * @param value
+   * @return true upon success
+   */
+  bool insert (const KeyT &key, const ValueT &value);
+  bool insert (KeyT &&key, ValueT &&value); // moves both into the map
+
+  /**
+   * Erase pair
+   * Erasing down to N / 2 pairs demotes the map; if that throws, the pair
+   * is still erased and the map stays promoted (see demote)
+   * @param key
+   * @return true upon success of operation
+   */
+  virtual bool erase (const KeyT &key);
+
+  /**
+   * Clear all pairs, and free the HashMap of a promoted map
+   */
+  void clear ();
+
+  // Operators
+
+  /**
+   * At operator
+   * Raises exceptions if does not exist
+   * @param key
+   * @return ValueT if exists
+   */
+  ValueT &at (const KeyT &key);
+  const ValueT &at (const KeyT &key) const; // const version
+
+  /**
+   * Operator []
+   * Inserts a default ValueT if key does not exist
+   * @param key
+   * @return ValueT
+   */
+  ValueT &operator[] (const KeyT &key);
+  const ValueT &operator[] (const KeyT &key) const { return at (key); }
+
+  /**
+   * Try Get Function
+   * @param key
+   * @return pointer to the value of key, or nullptr if key does not exist
+   */
+  ValueT *try_get (const KeyT &key);
+  const ValueT *try_get (const KeyT &key) const;
+
+  /**
+   * Operator ==
+   * @param other
+   * @return true if both maps hold the same pairs, in any order
+   */
+  bool operator== (const SmallHashMap &other) const;
+  bool operator!= (const SmallHashMap &other) const
+  { return !(operator== (other)); }
+
+  // Begin & End functions
+  class ConstIterator;
+  using const_iterator = ConstIterator;
+  const_iterator begin () const;
+  const_iterator cbegin () const { return begin (); }
+  const_iterator end () const;
+  const_iterator cend () const { return end (); }
+
+  // Nested class - ConstIterator
+  class ConstIterator {
+    friend class SmallHashMap;
+    // Privates
+    const pair_type *pair; // Inline pair, null for a promoted map
+    typename table_type::const_iterator table_it; // Pair of a promoted map
+
+    ConstIterator (const pair_type *pair,
+                   typename table_type::const_iterator table_it)
+        : pair (pair), table_it (table_it) {}
+
+   public:
+    // Iterator traits:
+    typedef std::pair<KeyT, ValueT> value_type;
+    typedef const value_type &reference;
+    typedef const value_type *pointer;
+    typedef std::ptrdiff_t difference_type;
+    typedef std::forward_iterator_tag iterator_category;
+
+    ConstIterator &operator++ ()
+    {
+      if (pair)
+        {
+          pair++;
+        }
+      else
+        {
+          ++table_it;
+        }
+      return *this;
+    }
+
+    ConstIterator operator++ (int)
+    {
+      ConstIterator tmp_it (*this);
+      ++(*this);
+      return tmp_it;
+    }
+
+    bool operator== (const ConstIterator &rhs) const
+    { return pair == rhs.pair && table_it == rhs.table_it; }
+
+    bool operator!= (const ConstIterator &rhs) const
+    { return !(*this == rhs); }
+
+    // Access operators
+    reference operator* () const { return pair ? *pair : *table_it; }
+    pointer operator-> () const { return &(operator* ()); }
+  };
+};
+
+template<class KeyT, class ValueT, int N>
+SmallHashMap<KeyT, ValueT, N>:: SmallHashMap
+    (const std::vector<KeyT> &keyVec, const std::vector<ValueT> &valVec)
+{
+  if (keyVec.size () != valVec.size ())
+    {
+      throw std::length_error (VECTOR_LENGTH);
+    }
+  for (int i = 0; i < (int) keyVec.size (); i++)
+    {
+      (*this)[keyVec[i]] = valVec[i];
+    }
+}
+
+template<class KeyT, class ValueT, int N>
+SmallHashMap<KeyT, ValueT, N>:: SmallHashMap (const SmallHashMap &other)
+{
+  if (other.table)
+    {
+      table.reset (new table_type (*other.table));
+      return;
+    }
+  try
+    {
+      for (; _small_size < other._small_size; _small_size++)
+        {
+          new (inline_pairs () + _small_size)
+              pair_type (other.inline_pairs ()[_small_size]);
+        }
+    }
+  catch (...)
+    {
+      destroy_inline ();
+      throw;
+    }
+}
+
+template<class KeyT, class ValueT, int N>
+SmallHashMap<KeyT, ValueT, N> &SmallHashMap<KeyT, ValueT, N>:: operator=
+    (const SmallHashMap &other)
+{
+  if (this != &other)
+    {
+      SmallHashMap copy (other);
+      clear ();
+      take (std::move (copy));
+    }
+  return *this;
+}
+
+template<class KeyT, class ValueT, int N>
+void SmallHashMap<KeyT, ValueT, N>:: take (SmallHashMap &&other)
+    noexcept (nothrow_move)
+{
+  table = std::move (other.table);
+  for (; _small_size < other._small_size; _small_size++)
+    {
+      new (inline_pairs () + _small_size)
+          pair_type (std::move (other.inline_pairs ()[_small_size]));
+    }
+  other.destroy_inline ();
+}
+
+template<class KeyT, class ValueT, int N>
+void SmallHashMap<KeyT, ValueT, N>:: destroy_inline ()
+{
+  for (int i = 0; i < _small_size; i++)
+    {
+      inline_pairs ()[i].~pair_type ();
+    }
+  _small_size = INIT;
+}
+
+template<class KeyT, class ValueT, int N>
+void SmallHashMap<KeyT, ValueT, N>:: promote ()
+{
+  // Copies, so the inline pairs stay intact if building the table throws
+  std::unique_ptr<table_type> new_table (new table_type ());
+  new_table->reserve (N + 1);
+  for (int i = 0; i < _small_size; i++)
+    {
+      const pair_type &pair = inline_pairs ()[i];
+      new_table->insert (pair.first, pair.second);
+    }
+  destroy_inline ();
+  table = std::move (new_table);
+}
+
+template<class KeyT, class ValueT, int N>
+void SmallHashMap<KeyT, ValueT, N>:: demote ()
+{
+  // The inline storage is idle while promoted, so the pairs are built
+  // there and committed to _small_size at the end
+  std::integral_constant<bool, std::is_nothrow_copy_constructible<KeyT>
+      ::value && std::is_nothrow_move_constructible<ValueT>::value> can_move;
+  int built = INIT;
+  try
+    {
+      for (auto it = table->mbegin (); it != table->mend (); ++it, built++)
+        {
+          new (inline_pairs () + built)
+              pair_type (it->first, demoted_value (it->second, can_move));
+        }
+    }
+  catch (...)
+    {
+      for (int i = 0; i < built; i++)
+        {
+          inline_pairs ()[i].~pair_type ();
+        }
+      throw;
+    }
+  _small_size = built;
+  table.reset ();
+}
+
+template<class KeyT, class ValueT, int N>
+template<class... Args>
+ValueT &SmallHashMap<KeyT, ValueT, N>:: append (Args &&... args)
+{
+  if (_small_size == N)
+    {
+      promote ();
+      pair_type pair (std::forward<Args> (args)...);
+      return table->compute_if_absent (pair.first, [&pair] ()
+      { return std::move (pair.second); });
+    }
+  pair_type *pair = new (inline_pairs () + _small_size)
+      pair_type (std::forward<Args> (args)...);
+  _small_size++;
+  return pair->second;
+}
+
+template<class KeyT, class ValueT, int N>
+bool SmallHashMap<KeyT, ValueT, N>:: insert (const KeyT &key,
+                                             const ValueT &value)
+{
+  if (table)
+    {
+      return table->insert (key, value);
+    }
+  if (find_inline (key) != -1)
+    {
+      return false;
+    }
+  append (key, value);
+  return true;
+}
+
+template<class KeyT, class ValueT, int N>
+bool SmallHashMap<KeyT, ValueT, N>:: insert (KeyT &&key, ValueT &&value)
+{
+  if (table)
+    {
+      return table->insert (std::move (key), std::move (value));
+    }
+  if (find_inline (key) != -1)
+    {
+      return false;
+    }
+  append (std::move (key), std::move (value));
+  return true;
+}
+
+template<class KeyT, class ValueT, int N>
+bool SmallHashMap<KeyT, ValueT, N>:: erase (const KeyT &key)
+{
+  if (table)
+    {
+      if (!table->erase (key))
+        {
+          return false;
+        }
+      if (table->size () <= N / 2)
+        {
+          demote ();
+        }
+      return true;
+    }
+  int ind = find_inline (key);
+  if (ind == -1)
+    {
+      return false;
+    }
+  pair_type *pairs = inline_pairs ();
+  if (ind != _small_size - 1)
+    {
+      pairs[ind] = std::move (pairs[_small_size - 1]);
+    }
+  pairs[--_small_size].~pair_type ();
+  return true;
+}
+
+template<class KeyT, class ValueT, int N>
+void SmallHashMap<KeyT, ValueT, N>:: clear ()
+{
+  destroy_inline ();
+  table.reset ();
+}
+
+template<class KeyT, class ValueT, int N>
+ValueT &SmallHashMap<KeyT, ValueT, N>:: at (const KeyT &key)
+{
+  ValueT *value = try_get (key);
+  if (!value)
+    {
+      throw std::invalid_argument (KEY_NOT_FOUND);
+    }
+  return *value;
+}
+
+template<class KeyT, class ValueT, int N>
+const ValueT &SmallHashMap<KeyT, ValueT, N>:: at (const KeyT &key) const
+{
+  const ValueT *value = try_get (key);
+  if (!value)
+    {
+      throw std::invalid_argument (KEY_NOT_FOUND);
+    }
+  return *value;
+}
+
+template<class KeyT, class ValueT, int N>
+ValueT &SmallHashMap<KeyT, ValueT, N>:: operator[] (const KeyT &key)
+{
+  if (table)
+    {
+      return (*table)[key];
+    }
+  int ind = find_inline (key);
+  if (ind != -1)
+    {
+      return inline_pairs ()[ind].second;
+    }
+  return append (key, ValueT ());
+}
+
+template<class KeyT, class ValueT, int N>
+ValueT *SmallHashMap<KeyT, ValueT, N>:: try_get (const KeyT &key)
+{
+  if (table)
+    {
+      return table->try_get (key);
+    }
+  int ind = find_inline (key);
+  return ind == -1 ? nullptr : &inline_pairs ()[ind].second;
+}
+
+template<class KeyT, class ValueT, int N>
+const ValueT *SmallHashMap<KeyT, ValueT, N>:: try_get (const KeyT &key) const
+{
+  if (table)
+    {
+      return static_cast<const table_type &> (*table).try_get (key);
+    }
+  int ind = find_inline (key);
+  return ind == -1 ? nullptr : &inline_pairs ()[ind].second;
+}
+
+template<class KeyT, class ValueT, int N>
+bool SmallHashMap<KeyT, ValueT, N>:: operator== (const SmallHashMap &other)
+    const
+{
+  if (size () != other.size ())
+    {
+      return false;
+    }
+  for (const auto &it : other)
+    {
+      const ValueT *value = try_get (it.first);
+      if (!value || *value != it.second)
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+template<class KeyT, class ValueT, int N>
+typename SmallHashMap<KeyT, ValueT, N>::const_iterator
+SmallHashMap<KeyT, ValueT, N>:: begin () const
+{
+  if (table)
+    {
+      return ConstIterator (nullptr, table->begin ());
+    }
+  return ConstIterator (inline_pairs (), {});
+}
+
+template<class KeyT, class ValueT, int N>
+typename SmallHashMap<KeyT, ValueT, N>::const_iterator
+SmallHashMap<KeyT, ValueT, N>:: end () const
+{
+  if (table)
+    {
+      return ConstIterator (nullptr, table->end ());
+    }
+  return ConstIterator (inline_pairs () + _small_size, {});
+}
+
+#endif //SMALLHASHMAP_EX6
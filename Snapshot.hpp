@@ -0,0 +1,589 @@
+#ifndef SNAPSHOT_EX6
+#define SNAPSHOT_EX6
+
+#include "HashMap.hpp"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
+#define SNAPSHOT_MAGIC "EX6SNAP"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_ALIGN 8
+#define SNAPSHOT_SLOT_EMPTY UINT32_MAX
+#define SNAPSHOT_STRING_KIND 0
+#define SNAPSHOT_IO "Error: Snapshot file I/O failed"
+#define SNAPSHOT_CORRUPT "Error: Invalid snapshot file"
+#define SNAPSHOT_TOO_LONG "Error: Snapshot key or value passes 4 GiB"
+
+/**
+ * Snapshot file format (native byte order), every section 8-byte aligned
+ * and addressed by its offset from the start of the file, so the image is
+ * usable wherever it is mapped:
+ * header   snapshot_header
+ * entries  one snapshot_entry per pair
+ * slots    open-addressing table (power of two, at most half full) of
+ *          uint32 entry indexes, SNAPSHOT_SLOT_EMPTY for a free slot
+ * data     key bytes then value bytes of every pair, each padded to
+ *          SNAPSHOT_ALIGN, so a trivially copyable value is read in place
+ * The checksum covers everything after the header.
+ */
+struct snapshot_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t key_kind; // SNAPSHOT_STRING_KIND or sizeof a trivial type
+    uint32_t value_kind;
+    uint32_t reserved;
+    uint64_t count;
+    uint64_t slot_count;
+    uint64_t entries_offset;
+    uint64_t slots_offset;
+    uint64_t data_offset;
+    uint64_t file_size;
+    uint64_t checksum;
+};
+
+struct snapshot_entry {
+    uint64_t hash;
+    uint64_t offset; // Of the key bytes, from data_offset
+    uint32_t key_size;
+    uint32_t value_size;
+};
+
+/**
+ * Byte hash of the format (FNV-1a, then mixed): keys must hash the same in
+ * every process that maps the file, which std::hash does not promise
+ */
+inline uint64_t snapshot_hash (const char *data, size_t n,
+                               uint64_t h = 0xcbf29ce484222325ULL)
+{
+  for (size_t i = 0; i < n; i++)
+    {
+      h = (h ^ (unsigned char) data[i]) * 0x100000001b3ULL;
+    }
+  return h;
+}
+
+inline size_t snapshot_pad (size_t n)
+{ return (n + SNAPSHOT_ALIGN - 1) / SNAPSHOT_ALIGN * SNAPSHOT_ALIGN; }
+
+/**
+ * SnapshotString class
+ * A string stored in a mapped snapshot: a pointer and a size into the
+ * mapping, valid as long as the map is open. Nothing is copied unless
+ * str () is called.
+ */
+class SnapshotString {
+  const char *_data;
+  size_t _size;
+
+ public:
+  SnapshotString (const char *data, size_t size) : _data (data), _size (size)
+  {}
+  const char *data () const { return _data; }
+  size_t size () const { return _size; }
+  std::string str () const { return std::string (_data, _size); }
+#if __cplusplus >= 201703L
+  operator std::string_view () const { return {_data, _size}; }
+#endif
+
+  bool operator== (const SnapshotString &rhs) const
+  { return _size == rhs._size && !std::memcmp (_data, rhs._data, _size); }
+  bool operator!= (const SnapshotString &rhs) const { return !(*this == rhs); }
+  bool operator== (const std::string &rhs) const
+  { return *this == SnapshotString (rhs.data (), rhs.size ()); }
+  bool operator!= (const std::string &rhs) const { return !(*this == rhs); }
+};
+
+/**
+ * snapshot_codec trait
+ * How a key or value type is stored: trivially copyable types as their
+ * bytes (read back in place), std::string as its characters. Addresses
+ * mean nothing in another process, so pointers are rejected, and a type
+ * must not need more than SNAPSHOT_ALIGN to be read in place.
+ */
+template<class T, class = void>
+struct snapshot_codec;
+
+template<class T>
+struct snapshot_codec<T, typename std::enable_if<
+    std::is_trivially_copyable<T>::value>::type> {
+  static_assert (!std::is_pointer<T>::value
+                 && !std::is_member_pointer<T>::value,
+                 "snapshot types cannot hold addresses");
+  static_assert (alignof (T) <= SNAPSHOT_ALIGN,
+                 "snapshot types cannot be aligned past SNAPSHOT_ALIGN");
+  typedef const T &view_type;
+  static const uint32_t kind = sizeof (T);
+  static const char *data (const T &v)
+  { return reinterpret_cast<const char *> (&v); }
+  static size_t size (const T &) { return sizeof (T); }
+  static view_type view (const char *data, size_t)
+  { return *reinterpret_cast<const T *> (data); }
+};
+
+template<>
+struct snapshot_codec<std::string> {
+  typedef SnapshotString view_type;
+  static const uint32_t kind = SNAPSHOT_STRING_KIND;
+  static const char *data (const std::string &v) { return v.data (); }
+  static size_t size (const std::string &v) { return v.size (); }
+  static view_type view (const char *data, size_t size)
+  { return SnapshotString (data, size); }
+};
+
+/**
+ * snapshot_key trait
+ * Whether a type can be a snapshot key: keys are hashed and compared as
+ * their bytes, which only integral and enum types and std::string have
+ * one of per value (no padding, no +-0.0 or NaN)
+ */
+template<class T>
+struct snapshot_key : std::integral_constant<bool, std::is_integral<T>::value
+    || std::is_enum<T>::value || std::is_same<T, std::string>::value> {};
+
+/**
+ * Snapshot Writer
+ * Writes a section and folds it into the checksum
+ */
+class snapshot_writer {
+  std::ofstream out;
+  uint64_t _checksum = 0xcbf29ce484222325ULL;
+
+ public:
+  /**
+   * Open path and leave room for the header, written last
+   */
+  explicit snapshot_writer (const std::string &path)
+      : out (path, std::ios::binary | std::ios::trunc)
+  {
+    if (!out)
+      {
+        throw std::runtime_error (SNAPSHOT_IO);
+      }
+    snapshot_header placeholder = {};
+    out.write ((const char *) &placeholder, sizeof (placeholder));
+  }
+
+  void write (const void *data, size_t n)
+  {
+    _checksum = snapshot_hash ((const char *) data, n, _checksum);
+    out.write ((const char *) data, (std::streamsize) n);
+  }
+
+  void pad (size_t n)
+  {
+    static const char zeros[SNAPSHOT_ALIGN] = {};
+    write (zeros, snapshot_pad (n) - n);
+  }
+
+  uint64_t checksum () const { return _checksum; }
+
+  /**
+   * Write the header at the start of the file, and close it
+   */
+  void finish (const snapshot_header &header)
+  {
+    out.seekp (0);
+    out.write ((const char *) &header, sizeof (header));
+    out.close ();
+    if (!out)
+      {
+        throw std::runtime_error (SNAPSHOT_IO);
+      }
+  }
+};
+
+template<class KeyT, class ValueT, class Hash, class KeyEqual, bool StoreHash,
+    bool SplitKeys>
+void HashMap<KeyT,ValueT,Hash,KeyEqual,StoreHash,SplitKeys>:: save_snapshot
+    (const std::string &path) const
+{
+  typedef snapshot_codec<KeyT> key_codec;
+  typedef snapshot_codec<ValueT> value_codec;
+  static_assert (snapshot_key<KeyT>::value,
+                 "snapshot keys are integral, enum or std::string");
+  static_assert (std::is_same<KeyEqual, std::equal_to<KeyT>>::value
+                 || std::is_same<KeyEqual, std::equal_to<>>::value,
+                 "snapshot lookups compare key bytes, not KeyEqual");
+  // Layout first, then the sections in file order; the pairs are visited
+  // twice in the same order, the map does not change meanwhile
+  std::vector<snapshot_entry> entries;
+  entries.reserve (_size);
+  uint64_t offset = INIT;
+  for (const auto &pair : *this)
+    {
+      size_t key_size = key_codec::size (pair.first);
+      size_t value_size = value_codec::size (pair.second);
+      if (key_size > UINT32_MAX || value_size > UINT32_MAX)
+        {
+          throw std::length_error (SNAPSHOT_TOO_LONG); // nothing written yet
+        }
+      snapshot_entry entry;
+      entry.key_size = (uint32_t) key_size;
+      entry.value_size = (uint32_t) value_size;
+      entry.hash = hash_mix (snapshot_hash (key_codec::data (pair.first),
+                                            entry.key_size));
+      entry.offset = offset;
+      offset += snapshot_pad (entry.key_size) + snapshot_pad (entry.value_size);
+      entries.push_back (entry);
+    }
+  uint64_t slot_count = MULT;
+  while (slot_count < entries.size () * MULT)
+    {
+      slot_count *= MULT;
+    }
+  std::vector<uint32_t> slots (slot_count, SNAPSHOT_SLOT_EMPTY);
+  for (uint32_t i = 0; i < entries.size (); i++)
+    {
+      uint64_t slot = entries[i].hash & (slot_count - HASH_HELP);
+      while (slots[slot] != SNAPSHOT_SLOT_EMPTY)
+        {
+          slot = (slot + 1) & (slot_count - HASH_HELP);
+        }
+      slots[slot] = i;
+    }
+
+  snapshot_header header = {};
+  std::memcpy (header.magic, SNAPSHOT_MAGIC, sizeof (SNAPSHOT_MAGIC));
+  header.version = SNAPSHOT_VERSION;
+  header.key_kind = key_codec::kind;
+  header.value_kind = value_codec::kind;
+  header.count = entries.size ();
+  header.slot_count = slot_count;
+  header.entries_offset = sizeof (snapshot_header);
+  header.slots_offset = header.entries_offset
+                        + entries.size () * sizeof (snapshot_entry);
+  header.data_offset = header.slots_offset
+                       + snapshot_pad (slot_count * sizeof (uint32_t));
+  header.file_size = header.data_offset + offset;
+
+  snapshot_writer writer (path);
+  writer.write (entries.data (), entries.size () * sizeof (snapshot_entry));
+  writer.write (slots.data (), slots.size () * sizeof (uint32_t));
+  writer.pad (slots.size () * sizeof (uint32_t));
+  for (const auto &pair : *this)
+    {
+      size_t key_size = key_codec::size (pair.first);
+      size_t value_size = value_codec::size (pair.second);
+      writer.write (key_codec::data (pair.first), key_size);
+      writer.pad (key_size);
+      writer.write (value_codec::data (pair.second), value_size);
+      writer.pad (value_size);
+    }
+  header.checksum = writer.checksum ();
+  writer.finish (header);
+}
+
+/**
+ * MappedHashMap class
+ * Read-only map served straight from a snapshot file (see
+ * HashMap::save_snapshot) mapped into memory: opening it parses nothing
+ * and copies nothing, pages are read on first touch, and processes that
+ * map the same file share them in the page cache. A lookup hashes the key
+ * bytes, probes the slots and compares the key bytes in place.
+ * at () and iteration return views into the mapping, valid while the map is
+ * open: const ValueT & for trivially copyable types, SnapshotString for
+ * std::string.
+ * @tparam KeyT std::string, an integral or an enum type (see snapshot_key)
+ * @tparam ValueT std::string or a trivially copyable type (see
+ * snapshot_codec)
+ */
+template<class KeyT, class ValueT>
+class MappedHashMap {
+
+  // Private Members
+  typedef snapshot_codec<KeyT> key_codec;
+  typedef snapshot_codec<ValueT> value_codec;
+  static_assert (snapshot_key<KeyT>::value,
+                 "snapshot keys are integral, enum or std::string");
+  const char *base = nullptr; // Start of the mapping
+  size_t length = INIT; // Bytes mapped
+  const snapshot_header *header = nullptr;
+  const snapshot_entry *entries = nullptr;
+  const uint32_t *slots = nullptr;
+  const char *data = nullptr;
+
+  MappedHashMap () = default;
+
+  /**
+   * Check the header against the file and the types, throws if invalid
+   */
+  void validate () const;
+
+  /**
+   * Find the entry of key
+   * @return the entry, or nullptr if key does not exist
+   */
+  const snapshot_entry *find_entry (const KeyT &key) const;
+
+  /**
+   * Entry at ind, throws if it points outside the file or does not fit
+   * the types (the header alone does not vouch for every entry)
+   */
+  const snapshot_entry &entry_at (uint64_t ind) const;
+
+  const char *value_data (const snapshot_entry &entry) const
+  { return data + entry.offset + snapshot_pad (entry.key_size); }
+
+ public:
+  typedef typename key_codec::view_type key_view;
+  typedef typename value_codec::view_type value_view;
+
+  /**
+   * Open Function
+   * Maps the snapshot at path. The header is always checked; the checksum
+   * reads the whole file, so it is checked only on request.
+   * @param path
+   * @param verify whether to check the checksum too
+   * @return the map; throws std::runtime_error if the file cannot be
+   * mapped or is not a snapshot of this key and value type
+   */
+  static MappedHashMap open (const std::string &path, bool verify = false);
+
+  // Move only, the map owns the mapping
+  MappedHashMap (MappedHashMap &&other) noexcept { *this = std::move (other); }
+  MappedHashMap &operator= (MappedHashMap &&other) noexcept
+  {
+    std::swap (base, other.base);
+    std::swap (length, other.length);
+    std::swap (header, other.header);
+    std::swap (entries, other.entries);
+    std::swap (slots, other.slots);
+    std::swap (data, other.data);
+    return *this;
+  }
+  MappedHashMap (const MappedHashMap &) = delete;
+  MappedHashMap &operator= (const MappedHashMap &) = delete;
+  virtual ~MappedHashMap ()
+  {
+    if (base)
+      {
+        munmap ((void *) base, length);
+      }
+  }
+
+  // Getters and Checkers
+  int size () const { return header ? (int) header->count : INIT; }
+  bool empty () const { return size () == INIT; }
+  bool contains_key (const KeyT &key) const { return find_entry (key); }
+
+  /**
+   * Verify Function
+   * @return true if the checksum matches the contents
+   */
+  bool verify () const;
+
+  // Operators
+
+  /**
+   * At operator
+   * Raises exceptions if does not exist
+   * @param key
+   * @return view of the value of key
+   */
+  value_view at (const KeyT &key) const;
+  value_view operator[] (const KeyT &key) const { return at (key); }
+
+  // Begin & End functions, in entry order
+  class ConstIterator;
+  using const_iterator = ConstIterator;
+  const_iterator begin () const { return ConstIterator (*this, INIT); }
+  const_iterator cbegin () const { return begin (); }
+  const_iterator end () const { return ConstIterator (*this, size ()); }
+  const_iterator cend () const { return end (); }
+
+  // Nested class - ConstIterator
+  // Yields the pairs as views, by value
+  class ConstIterator {
+    // Privates
+    const MappedHashMap *mapped_map; // map to iterate on
+    int entry_ind; // Index of entry, size () at the end
+
+   public:
+    // Iterator traits:
+    typedef std::pair<key_view, value_view> value_type;
+    typedef value_type reference;
+    typedef void pointer;
+    typedef std::ptrdiff_t difference_type;
+    typedef std::forward_iterator_tag iterator_category;
+
+    ConstIterator (const MappedHashMap &mapped_map, int entry_ind)
+        : mapped_map (&mapped_map), entry_ind (entry_ind) {}
+
+    ConstIterator &operator++ ()
+    {
+      entry_ind++;
+      return *this;
+    }
+
+    ConstIterator operator++ (int)
+    {
+      ConstIterator tmp_it (*this);
+      ++(*this);
+      return tmp_it;
+    }
+
+    bool operator== (const ConstIterator &rhs) const
+    { return mapped_map == rhs.mapped_map && entry_ind == rhs.entry_ind; }
+
+    bool operator!= (const ConstIterator &rhs) const
+    { return !(*this == rhs); }
+
+    // Access operator
+    reference operator* () const
+    {
+      const snapshot_entry &entry = mapped_map->entry_at (entry_ind);
+      return value_type (
+          key_codec::view (mapped_map->data + entry.offset, entry.key_size),
+          value_codec::view (mapped_map->value_data (entry),
+                             entry.value_size));
+    }
+  };
+};
+
+/**
+ * MappedDictionary, the snapshot of a Dictionary
+ */
+typedef MappedHashMap<std::string, std::string> MappedDictionary;
+
+template<class KeyT, class ValueT>
+MappedHashMap<KeyT, ValueT> MappedHashMap<KeyT, ValueT>:: open
+    (const std::string &path, bool verify)
+{
+  int fd = ::open (path.c_str (), O_RDONLY);
+  if (fd == -1)
+    {
+      throw std::runtime_error (SNAPSHOT_IO);
+    }
+  struct stat info;
+  if (fstat (fd, &info) == -1 || info.st_size < (off_t) sizeof
+      (snapshot_header))
+    {
+      close (fd);
+      throw std::runtime_error (SNAPSHOT_CORRUPT);
+    }
+  void *mapping = mmap (nullptr, (size_t) info.st_size, PROT_READ, MAP_SHARED,
+                        fd, 0);
+  close (fd); // The mapping keeps the file open
+  if (mapping == MAP_FAILED)
+    {
+      throw std::runtime_error (SNAPSHOT_IO);
+    }
+  MappedHashMap map;
+  map.base = (const char *) mapping;
+  map.length = (size_t) info.st_size;
+  map.header = (const snapshot_header *) map.base;
+  map.validate ();
+  map.entries = (const snapshot_entry *) (map.base
+                                          + map.header->entries_offset);
+  map.slots = (const uint32_t *) (map.base + map.header->slots_offset);
+  map.data = map.base + map.header->data_offset;
+  if (verify && !map.verify ())
+    {
+      throw std::runtime_error (SNAPSHOT_CORRUPT);
+    }
+  return map;
+}
+
+template<class KeyT, class ValueT>
+void MappedHashMap<KeyT, ValueT>:: validate () const
+{
+  const snapshot_header &h = *header;
+  uint64_t slots_end = h.slots_offset + h.slot_count * sizeof (uint32_t);
+  if (std::memcmp (h.magic, SNAPSHOT_MAGIC, sizeof (SNAPSHOT_MAGIC))
+      || h.version != SNAPSHOT_VERSION || h.key_kind != key_codec::kind
+      || h.value_kind != value_codec::kind || h.file_size != length
+      || h.slot_count == INIT || (h.slot_count & (h.slot_count - 1))
+      || h.count >= h.slot_count || h.count > (uint64_t) INT32_MAX
+      || h.entries_offset != sizeof (snapshot_header)
+      || h.slots_offset != h.entries_offset
+                           + h.count * sizeof (snapshot_entry)
+      || h.data_offset != snapshot_pad (slots_end)
+      || h.data_offset > h.file_size)
+    {
+      throw std::runtime_error (SNAPSHOT_CORRUPT);
+    }
+}
+
+template<class KeyT, class ValueT>
+bool MappedHashMap<KeyT, ValueT>:: verify () const
+{
+  return snapshot_hash (base + sizeof (snapshot_header),
+                        length - sizeof (snapshot_header))
+         == header->checksum;
+}
+
+template<class KeyT, class ValueT>
+const snapshot_entry *MappedHashMap<KeyT, ValueT>:: find_entry
+    (const KeyT &key) const
+{
+  const char *key_data = key_codec::data (key);
+  size_t key_size = key_codec::size (key);
+  uint64_t hash = hash_mix (snapshot_hash (key_data, key_size));
+  uint64_t mask = header->slot_count - HASH_HELP, slot = hash & mask;
+  for (uint64_t probes = INIT; probes < header->slot_count; probes++)
+    {
+      uint32_t ind = slots[slot];
+      if (ind == SNAPSHOT_SLOT_EMPTY)
+        {
+          return nullptr;
+        }
+      const snapshot_entry &entry = entry_at (ind);
+      if (entry.hash == hash && entry.key_size == key_size
+          && !std::memcmp (data + entry.offset, key_data, key_size))
+        {
+          return &entry;
+        }
+      slot = (slot + 1) & mask;
+    }
+  throw std::runtime_error (SNAPSHOT_CORRUPT); // no free slot
+}
+
+template<class KeyT, class ValueT>
+const snapshot_entry &MappedHashMap<KeyT, ValueT>:: entry_at
+    (uint64_t ind) const
+{
+  if (ind >= header->count)
+    {
+      throw std::runtime_error (SNAPSHOT_CORRUPT);
+    }
+  const snapshot_entry &entry = entries[ind];
+  uint64_t data_size = header->file_size - header->data_offset;
+  uint64_t entry_size = snapshot_pad (entry.key_size)
+                        + snapshot_pad (entry.value_size);
+  if (entry.offset % SNAPSHOT_ALIGN || entry.offset > data_size
+      || entry_size > data_size - entry.offset
+      || (key_codec::kind != SNAPSHOT_STRING_KIND
+          && entry.key_size != key_codec::kind)
+      || (value_codec::kind != SNAPSHOT_STRING_KIND
+          && entry.value_size != value_codec::kind))
+    {
+      throw std::runtime_error (SNAPSHOT_CORRUPT);
+    }
+  return entry;
+}
+
+template<class KeyT, class ValueT>
+typename MappedHashMap<KeyT, ValueT>::value_view
+MappedHashMap<KeyT, ValueT>:: at (const KeyT &key) const
+{
+  const snapshot_entry *entry = find_entry (key);
+  if (!entry)
+    {
+      throw std::invalid_argument (KEY_NOT_FOUND);
+    }
+  return value_codec::view (value_data (*entry), entry->value_size);
+}
+
+#endif //SNAPSHOT_EX6
@@ -1,9 +1,18 @@
 
 // includes
 #include "HashMap.hpp"
-//#include "Dictionary.hpp"
+#include "FlatHashMap.hpp"
+#include "RobinHoodHashMap.hpp"
+#include "OrderedHashMap.hpp"
+#include "SmallHashMap.hpp"
+#include "FrozenMap.hpp"
+#include "FrozenHashMap.hpp"
+#include "Snapshot.hpp"
+#include "ArenaDictionary.hpp"
+#include "Dictionary.hpp"
 #include <iostream>
 #include <utility>
+#include <atomic>
 #include "sstream"
 #include <string>
 
@@ -40,6 +49,50 @@ struct std::hash<key_struct> {
     }
 };
 
+// Counts copies, to check that the move-aware paths never copy
+struct copy_counter {
+    static int copies;
+    int id;
+    copy_counter(int id = 0) : id(id) { }
+    copy_counter(const copy_counter& other) : id(other.id) { copies++; }
+    copy_counter(copy_counter&& other) noexcept : id(other.id) { }
+    copy_counter& operator=(const copy_counter& other)
+    { id = other.id; copies++; return *this; }
+    copy_counter& operator=(copy_counter&& other) noexcept
+    { id = other.id; return *this; }
+    bool operator==(const copy_counter& other) const { return id == other.id; }
+    bool operator!=(const copy_counter& other) const { return id != other.id; }
+};
+int copy_counter::copies = 0;
+
+// Case-insensitive string policies, to check custom Hash/KeyEqual. ASCII
+// only: tolower folds no other bytes
+struct nocase_hash {
+    size_t operator ()(const string& value) const {
+      string lower (value);
+      for (auto &c : lower) c = (char) tolower (c);
+      return std::hash<string>{} (lower);
+    }
+};
+struct nocase_equal {
+    bool operator ()(const string& a, const string& b) const {
+      if (a.size () != b.size ()) return false;
+      for (size_t i = 0; i < a.size (); i++)
+        if (tolower (a[i]) != tolower (b[i])) return false;
+      return true;
+    }
+};
+
+// Counts calls, to check how often the map hashes
+struct counting_hash {
+    static int calls;
+    size_t operator ()(const string& value) const {
+      calls++;
+      return std::hash<string>{} (value);
+    }
+};
+int counting_hash::calls = 0;
+
 // tests
 /**
  * @Tests:
@@ -1005,6 +1058,1467 @@ void test_const_correctness() {
   assert(h8.capacity()==32);
 }
 
+/**
+ * @tests:
+ * 0. FlatHashMap keeps the HashMap API semantics
+ * 1. Tombstones are reused and cleaned, lookups stay correct after churn
+ * 2. Probing works when all keys share the same tag and group
+ */
+void test_flat_hash_map ()
+{
+  START_TEST;
+  FlatHashMap<int, int> h1;
+  assert(h1.empty () && h1.capacity () == 16);
+  for (int i = 0; i < 1000; i++) assert(h1.insert (i, i * 10));
+  assert(h1.size () == 1000);
+  assert(h1.get_load_factor () <= 0.875);
+  assert(!h1.insert (5, 0));
+  for (int i = 0; i < 1000; i++) assert(h1.at (i) == i * 10);
+  assert(!h1.contains_key (1000));
+  bool thrown = false;
+  try { h1.at (1000); }
+  catch (exception &e) { thrown = true; }
+  assert(thrown);
+  for (int i = 0; i < 1000; i += 2) assert(h1.erase (i));
+  assert(!h1.erase (0));
+  assert(h1.size () == 500);
+  int counter = 0;
+  for (const auto &it : h1)
+    {
+      assert(it.first % 2 == 1 && it.second == it.first * 10);
+      counter++;
+    }
+  assert(counter == 500);
+
+  // Insert/erase churn at a fixed size must not grow the table forever
+  FlatHashMap<int, int> h2;
+  for (int i = 0; i < 10; i++) h2.insert (i, i);
+  for (int i = 10; i < 100000; i++)
+    {
+      assert(h2.erase (i - 10));
+      assert(h2.insert (i, i));
+    }
+  assert(h2.size () == 10 && h2.capacity () == 16);
+  for (int i = 99990; i < 100000; i++) assert(h2.at (i) == i);
+
+  FlatHashMap<string, string> h3 ({"a", "b", "a"}, {"1", "2", "3"});
+  assert(h3.size () == 2 && h3.at ("a") == "3");
+  h3["c"] = "4";
+  FlatHashMap<string, string> h4 (h3), h5;
+  h5 = h3;
+  assert(h4 == h3 && h5 == h3);
+  h4.erase ("c");
+  assert(h4 != h3 && h3.contains_key ("c"));
+
+  // All keys in one bucket of the std::hash
+  FlatHashMap<key_struct, int> h6;
+  for (int i = 0; i < 300; i++) h6.insert ({to_string (i), 0}, i);
+  for (int i = 0; i < 300; i++) assert(h6.at ({to_string (i), 0}) == i);
+  h6.clear ();
+  assert(h6.empty () && h6.begin () == h6.end ());
+}
+
+/**
+ * @tests:
+ * 0. RobinHoodHashMap keeps the HashMap API semantics
+ * 1. Backward-shift erase keeps every remaining key reachable
+ * 2. Probe lengths stay bounded at a 0.9 load factor after heavy churn
+ */
+void test_robin_hood_hash_map ()
+{
+  START_TEST;
+  RobinHoodHashMap<int, int> h1;
+  for (int i = 0; i < 5000; i++) assert(h1.insert (i, i * 10));
+  assert(!h1.insert (7, 0));
+  assert(h1.get_load_factor () <= 0.9);
+  for (int i = 0; i < 5000; i += 3) assert(h1.erase (i));
+  assert(!h1.erase (0));
+  for (int i = 0; i < 5000; i++)
+    assert(h1.contains_key (i) == (i % 3 != 0));
+  int counter = 0;
+  for (const auto &it : h1)
+    {
+      assert(it.second == it.first * 10);
+      counter++;
+    }
+  assert(counter == h1.size ());
+
+  RobinHoodHashMap<int, int> h2;
+  for (int i = 0; i < 900; i++) h2.insert (i, i);
+  int capacity = h2.capacity ();
+  for (int i = 900; i < 200000; i++)
+    {
+      assert(h2.erase (i - 900));
+      h2[i] = i;
+    }
+  assert(h2.capacity () == capacity && h2.size () == 900);
+  assert(h2.max_probe_length () < 32);
+  for (int i = 200000 - 900; i < 200000; i++) assert(h2.at (i) == i);
+
+  bool thrown = false;
+  try { h2.set_max_load_factor (1.5); }
+  catch (exception &e) { thrown = true; }
+  assert(thrown);
+
+  RobinHoodHashMap<string, string> h3 ({"a", "b", "a"}, {"1", "2", "3"});
+  assert(h3.size () == 2 && h3.at ("a") == "3");
+  RobinHoodHashMap<string, string> h4 (h3), h5;
+  h5 = h4;
+  assert(h5 == h3);
+  h5["c"] = "4";
+  assert(h5 != h3 && !h3.contains_key ("c"));
+
+  RobinHoodHashMap<key_struct, int> h6;
+  for (int i = 0; i < 300; i++) h6.insert ({to_string (i), 0}, i);
+  for (int i = 0; i < 300; i += 2) assert(h6.erase ({to_string (i), 0}));
+  for (int i = 1; i < 300; i += 2) assert(h6.at ({to_string (i), 0}) == i);
+}
+
+/**
+ * @tests:
+ * 0. Incremental resize keeps every key reachable while both arrays live
+ * 1. Capacity follows the same policy as a stop-the-world resize
+ * 2. Iteration and copies see old and new buckets exactly once
+ */
+void test_incremental_rehash ()
+{
+  START_TEST;
+  HashMap<int, int> h1, h2;
+  h1.set_incremental_rehash (true);
+  bool seen_resizing = false;
+  for (int i = 0; i < 3000; i++)
+    {
+      assert(h1.insert (i, i * 10));
+      h2.insert (i, i * 10);
+      seen_resizing |= h1.is_resizing ();
+      assert(h1.capacity () == h2.capacity ());
+      assert(h1.contains_key (i / 2) && h1.at (i / 3) == i / 3 * 10);
+    }
+  assert(seen_resizing);
+  int counter = 0;
+  for (const auto &it : h1)
+    {
+      assert(it.second == it.first * 10);
+      counter++;
+    }
+  assert(counter == 3000);
+  HashMap<int, int> h3 (h1);
+  assert(h3 == h1 && h1 == h2);
+  for (int i = 0; i < 2990; i++)
+    {
+      assert(h1.erase (i));
+      h2.erase (i);
+      assert(h1.capacity () == h2.capacity ());
+      assert(!h1.contains_key (i) && h1[i + 1] == (i + 1) * 10);
+    }
+  assert(h1.size () == 10 && h1 == h2);
+  h1.set_incremental_rehash (false);
+  assert(!h1.is_resizing ());
+
+  HashMap<string, string> h4;
+  h4.set_incremental_rehash (true);
+  for (int i = 0; i < 100; i++) h4[to_string (i)] = to_string (i);
+  h4.clear ();
+  assert(h4.empty () && h4.begin () == h4.end ());
+  h4["a"] = "b";
+  assert(h4.at ("a") == "b");
+}
+
+/**
+ * @tests:
+ * 0. insert(&&), emplace and try_emplace construct without copies
+ * 1. try_emplace doesn't touch its arguments when the key exists
+ * 2. Move construction/assignment steal buckets, moved-from map is reusable
+ * 3. Rehash relocates pairs by move
+ */
+void test_move_semantics ()
+{
+  START_TEST;
+  copy_counter::copies = 0;
+  HashMap<int, copy_counter> h1;
+  for (int i = 0; i < 100; i++) assert(h1.insert (int (i), copy_counter (i)));
+  for (int i = 100; i < 200; i++) assert(h1.emplace (i, copy_counter (i)));
+  for (int i = 200; i < 300; i++) assert(h1.try_emplace (i, i));
+  assert(!h1.emplace (5, copy_counter (0)));
+  assert(copy_counter::copies == 0); // rehashes included
+  assert(h1.size () == 300 && h1.at (250).id == 250);
+
+  HashMap<string, string> h2;
+  string key = "key", value (1000, 'v');
+  assert(h2.try_emplace (std::move (key), std::move (value)));
+  assert(h2.at ("key").size () == 1000);
+  string again (1000, 'w');
+  assert(!h2.try_emplace ("key", std::move (again)));
+  assert(again.size () == 1000); // not consumed
+
+  HashMap<int, copy_counter> h3 (std::move (h1));
+  assert(copy_counter::copies == 0);
+  assert(h3.size () == 300 && h1.empty ());
+  assert(!h1.contains_key (1) && h1.begin () == h1.end ());
+  assert(h1.insert (1, copy_counter (1)) && h1.at (1).id == 1);
+  h1 = std::move (h3);
+  assert(copy_counter::copies == 0);
+  assert(h1.size () == 300 && h1.at (299).id == 299);
+  HashMap<int, copy_counter> h4 (h3);
+  assert(h4.insert (7, copy_counter (7)));
+}
+
+/**
+ * @tests:
+ * 0. Identity-hashed keys with a common stride spread over the buckets
+ * 1. All-colliding std::hash values still share one bucket
+ * 2. Custom Hash/KeyEqual policies are used for lookups
+ */
+void test_hash_policies ()
+{
+  START_TEST;
+  HashMap<int64_t, int> h1;
+  for (int64_t i = 0; i < 1000; i++) h1.insert (i << 20, (int) i);
+  int longest = 0;
+  for (int64_t i = 0; i < 1000; i++)
+    longest = std::max (longest, h1.bucket_size (i << 20));
+  assert(longest <= 8);
+  for (int64_t i = 0; i < 1000; i++) assert(h1.at (i << 20) == i);
+
+  struct same_hash {
+      size_t operator() (int) const { return 42; }
+  };
+  HashMap<int, int, same_hash> h4;
+  for (int i = 0; i < 50; i++) h4.insert (i, i);
+  for (int i = 0; i < 50; i++)
+    assert(h4.bucket_size (i) == 50 && h4.at (i) == i);
+  assert(h4.erase (7) && !h4.contains_key (7) && h4.bucket_size (0) == 49);
+
+  HashMap<string, int, nocase_hash, nocase_equal> h2;
+  assert(h2.insert ("Hello", 1));
+  assert(!h2.insert ("HELLO", 2));
+  assert(h2.contains_key ("hello") && h2.at ("hElLo") == 1);
+  h2["WORLD"] = 3;
+  assert(h2.erase ("world") && h2.size () == 1);
+  HashMap<string, int, nocase_hash, nocase_equal> h3 (h2);
+  assert(h3 == h2);
+}
+
+/**
+ * @tests:
+ * 0. String keys cache their hash: resizes never call the hash again
+ * 1. Without cached hashes every resize rehashes every key
+ * 2. Lookups, erase, copies and incremental resizes work on cached hashes
+ */
+void test_cached_hash ()
+{
+  START_TEST;
+  counting_hash::calls = 0;
+  HashMap<string, int, counting_hash> h1;
+  for (int i = 0; i < 1000; i++) h1.insert (to_string (i), i);
+  assert(counting_hash::calls == 1000); // one per insert, despite 6 resizes
+  HashMap<string, int, counting_hash> h2 (h1);
+  assert(counting_hash::calls == 1000);
+  for (int i = 0; i < 1000; i++) assert(h2.at (to_string (i)) == i);
+  for (int i = 0; i < 990; i++) assert(h2.erase (to_string (i)));
+  assert(h2.size () == 10 && h2.contains_key ("995"));
+
+  counting_hash::calls = 0;
+  HashMap<string, int, counting_hash, std::equal_to<string>, false> h3;
+  for (int i = 0; i < 1000; i++) h3.insert (to_string (i), i);
+  assert(counting_hash::calls > 1000);
+
+  HashMap<string, string> h4;
+  h4.set_incremental_rehash (true);
+  for (int i = 0; i < 500; i++) h4[to_string (i)] = to_string (i * 2);
+  for (int i = 0; i < 500; i++) assert(h4.at (to_string (i)) == to_string (i * 2));
+}
+
+/**
+ * @tests:
+ * 0. find returns end () on a miss and an iterator to the pair on a hit
+ * 1. The mutable iterator and try_get modify values in place, the iterator
+ * keeps keys const
+ * 2. get_or returns the default on a miss
+ * 3. operator[] inserts on a miss without any resize surprises
+ */
+void test_find_and_try_get ()
+{
+  START_TEST;
+  HashMap<int, string> h1 ({1, 2, 3}, {"a", "b", "c"});
+  assert(h1.find (4) == h1.end ());
+  auto it = h1.find (2);
+  assert(it != h1.end () && it->first == 2 && it->second == "b");
+  it->second = "B";
+  assert(h1.at (2) == "B");
+  // Only the value is mutable, the key is const
+  assert((std::is_const<std::remove_reference<decltype (it->first)>::type>
+      ::value));
+  assert((!std::is_const<std::remove_reference<decltype (it->second)>::type>
+      ::value));
+  std::pair<int, string> copy = *it;
+  assert(copy.first == 2 && copy.second == "B");
+  string *value = h1.try_get (3);
+  assert(value && *value == "c");
+  *value = "C";
+  assert(h1.at (3) == "C" && h1.try_get (4) == nullptr);
+  assert(h1.get_or (1, "z") == "a" && h1.get_or (9, "z") == "z");
+  HashMap<int, string>::const_iterator cit = h1.find (1);
+  cit = h1.find (3);
+  assert(cit->second == "C");
+
+  const HashMap<int, string> h2 (h1);
+  assert(h2.find (2)->second == "B" && h2.find (7) == h2.end ());
+  assert(*h2.try_get (1) == "a" && h2.try_get (7) == nullptr);
+
+  HashMap<int, int> h3;
+  for (int i = 0; i < 100; i++) h3[i] += i;
+  assert(h3.size () == 100 && h3.capacity () == 256);
+  for (int i = 0; i < 100; i++) assert(h3.find (i)->second == i);
+  h3.set_incremental_rehash (true);
+  for (int i = 100; i < 1000; i++)
+    {
+      h3[i] = i;
+      assert(h3.find (i / 2)->second == i / 2);
+    }
+  int counter = 0;
+  for (auto found = h3.find (500); found != h3.end (); ++found) counter++;
+  assert(counter >= 1);
+}
+
+/**
+ * @tests:
+ * 0. upsert / merge_value count events with one hash per call
+ * 1. compute_if_absent calls its factory only for a missing key
+ * 2. compute keeps, updates, removes or skips a key by its return value
+ */
+void test_read_modify_write ()
+{
+  START_TEST;
+  counting_hash::calls = 0;
+  HashMap<string, int, counting_hash> h1;
+  for (int i = 0; i < 100; i++)
+    {
+      h1.upsert (std::to_string (i % 10), [] (int &count) { count++; });
+    }
+  assert(counting_hash::calls == 100);
+  assert(h1.size () == 10 && h1.at ("3") == 10);
+  for (int i = 0; i < 10; i++)
+    {
+      h1.merge_value (std::to_string (i), i,
+                      [] (int a, int b) { return a + b; });
+    }
+  h1.merge_value ("50", 7, [] (int a, int b) { return a + b; });
+  assert(h1.at ("3") == 13 && h1.at ("50") == 7 && h1.size () == 11);
+
+  HashMap<string, string> h2;
+  int made = 0;
+  auto factory = [&made] () { made++; return string ("new"); };
+  assert(h2.compute_if_absent ("a", factory) == "new");
+  h2.compute_if_absent ("a", factory) += "!";
+  assert(made == 1 && h2.at ("a") == "new!");
+
+  HashMap<int, int> h3;
+  assert(h3.compute (1, [] (int &v, bool existed)
+  { v = 5; return !existed; }));
+  assert(h3.at (1) == 5);
+  assert(h3.compute (1, [] (int &v, bool) { v++; return true; }));
+  assert(h3.at (1) == 6);
+  assert(!h3.compute (1, [] (int &, bool) { return false; }));
+  assert(!h3.contains_key (1) && h3.empty ());
+  assert(!h3.compute (2, [] (int &, bool) { return false; }));
+  assert(h3.empty ());
+
+  bool thrown = false;
+  try
+    {
+      h3.upsert (4, [] (int &) { throw std::logic_error ("fn"); });
+    }
+  catch (const std::logic_error &)
+    {
+      thrown = true;
+    }
+  assert(thrown && !h3.contains_key (4));
+}
+
+/**
+ * @tests:
+ * 0. reserve presizes once, later inserts do not resize
+ * 1. rehash and shrink_to_fit pick the smallest fitting power of two
+ * 2. the minimum capacity stops the collapse on erase of the last pair
+ * 3. load factor hysteresis stops resizing on insert/erase oscillation
+ * 4. capacities past INT_MAX buckets throw instead of overflowing
+ */
+void test_capacity_management ()
+{
+  START_TEST;
+  HashMap<int, int> h1;
+  h1.reserve (1000);
+  int capacity = h1.capacity ();
+  assert(capacity == 2048);
+  for (int i = 0; i < 1000; i++) h1.insert (i, i);
+  assert(h1.capacity () == capacity);
+  h1.reserve (10);
+  assert(h1.capacity () == capacity); // reserve never shrinks
+  for (int i = 100; i < 1000; i++) h1.erase (i);
+  h1.shrink_to_fit ();
+  assert(h1.capacity () == 256 && h1.size () == 100);
+  for (int i = 0; i < 100; i++) assert(h1.at (i) == i);
+  h1.rehash (1000);
+  assert(h1.capacity () == 1024);
+  h1.rehash (1);
+  assert(h1.capacity () == 256);
+
+  HashMap<int, int> h2;
+  h2.set_min_capacity (10);
+  assert(h2.min_capacity () == 16 && h2.capacity () == 16);
+  h2.insert (1, 1);
+  h2.erase (1);
+  assert(h2.capacity () == 16 && h2.empty ());
+  for (int i = 0; i < 100; i++) h2.insert (i, i);
+  for (int i = 0; i < 100; i++) h2.erase (i);
+  assert(h2.capacity () == 16);
+  h2.shrink_to_fit ();
+  assert(h2.capacity () == 16);
+
+  HashMap<int, int> h3;
+  bool thrown = false;
+  try { h3.set_load_factors (0.75, 0.5); } // shrink would pass max
+  catch (const std::invalid_argument &) { thrown = true; }
+  assert(thrown);
+  h3.set_load_factors (0.75, 0.1);
+  for (int i = 0; i < 12; i++) h3.insert (i, i);
+  assert(h3.capacity () == 16);
+  h3.insert (12, 12); // grows: 13 / 16 > 0.75
+  assert(h3.capacity () == 32);
+  for (int round = 0; round < 10; round++)
+    {
+      h3.erase (12);
+      h3.insert (12, 12);
+      h3.erase (11);
+      h3.insert (11, 11);
+    }
+  assert(h3.capacity () == 32);
+  for (int i = 3; i < 13; i++) h3.erase (i);
+  assert(h3.capacity () == 16 && h3.size () == 3); // 3 / 32 < 0.1
+
+  HashMap<int, int> huge;
+  huge.insert (1, 1);
+  thrown = false;
+  try { huge.reserve (INT_MAX); } // needs 2^32 buckets at 0.75
+  catch (const std::length_error &) { thrown = true; }
+  assert(thrown);
+  thrown = false;
+  try { huge.rehash (INT_MAX); }
+  catch (const std::length_error &) { thrown = true; }
+  assert(thrown);
+  thrown = false;
+  try { huge.set_min_capacity (INT_MAX); }
+  catch (const std::length_error &) { thrown = true; }
+  assert(thrown);
+  assert(huge.capacity () == 16 && huge.min_capacity () == ERASE_LAST_INIT);
+  assert(huge.at (1) == 1); // unchanged by the throws
+
+  HashMap<int, int> h4 (h3);
+  assert(h4.min_load_factor () == 0.1 && h4.max_load_factor () == 0.75);
+  HashMap<int, int> h5 (std::move (h4));
+  assert(h5.min_load_factor () == 0.1);
+}
+
+/**
+ * @tests:
+ * 0. a large vector build (parallel path, forced to 4 threads, and the
+ * sequential one) matches inserting one by one: same pairs, last value of
+ * duplicate keys and same capacity
+ * 1. string keys with cached hashes
+ */
+void test_bulk_construction ()
+{
+  START_TEST;
+  vector<int> keys, values;
+  for (int i = 0; i < 200000; i++)
+    {
+      keys.push_back ((i * 7919) % 150000); // a third of the keys repeat
+      values.push_back (i);
+    }
+  HashMap<int, int> h1 (keys, values, 4);
+  HashMap<int, int> h2;
+  for (int i = 0; i < (int) keys.size (); i++) h2[keys[i]] = values[i];
+  assert(h1.size () == 150000 && h1.size () == h2.size ());
+  assert(h1.capacity () == h2.capacity ());
+  assert(h1 == h2);
+  HashMap<int, int> h4 (keys, values, 1);
+  assert(h4 == h2 && h4.capacity () == h2.capacity ());
+  for (int i = 0; i < 150000; i += 997) assert(h1.at (i) == h2.at (i));
+
+  vector<string> skeys, svalues;
+  for (int i = 0; i < 50000; i++)
+    {
+      skeys.push_back (to_string (i % 40000));
+      svalues.push_back (to_string (i));
+    }
+  HashMap<string, string> h3 (skeys, svalues, 3);
+  assert(h3.size () == 40000 && h3.capacity () == 65536);
+  assert(h3.at ("5") == "40005" && h3.at ("39999") == "39999");
+}
+
+/**
+ * @tests:
+ * 0. lookup_many / contains_many agree with at () and contains_key, over
+ * several batches, with hits, misses and repeated keys
+ * 1. values can be modified through lookup_many
+ * 2. batched lookups during an incremental resize and on an empty map
+ */
+void test_batched_lookup ()
+{
+  START_TEST;
+  HashMap<int, int> h1;
+  for (int i = 0; i < 1000; i += 2) h1.insert (i, i * 10);
+  vector<int> keys;
+  for (int i = 0; i < 300; i++) keys.push_back ((i * 37) % 700);
+  vector<int *> values (keys.size ());
+  bool found[300];
+  assert(h1.lookup_many (keys.data (), keys.size (), values.data ())
+         == h1.contains_many (keys.data (), keys.size (), found));
+  for (size_t i = 0; i < keys.size (); i++)
+    {
+      assert(found[i] == h1.contains_key (keys[i]));
+      assert(found[i] == (values[i] != nullptr));
+      if (found[i]) assert(*values[i] == keys[i] * 10);
+    }
+  *values[0] = -1;
+  assert(h1.at (keys[0]) == -1);
+
+  const HashMap<int, int> &h2 = h1;
+  vector<const int *> cvalues (keys.size ());
+  h2.lookup_many (keys.data (), keys.size (), cvalues.data ());
+  for (size_t i = 0; i < keys.size (); i++) assert(cvalues[i] == values[i]);
+
+  HashMap<string, int> h3;
+  h3.set_incremental_rehash (true);
+  vector<string> skeys;
+  for (int i = 0; i < 200; i++)
+    {
+      h3.insert (to_string (i), i);
+      skeys.push_back (to_string (i * 2));
+    }
+  assert(h3.is_resizing ());
+  vector<int *> svalues (skeys.size ());
+  assert(h3.lookup_many (skeys.data (), skeys.size (), svalues.data ()) == 100);
+  for (int i = 0; i < 100; i++) assert(*svalues[i] == i * 2);
+  for (int i = 100; i < 200; i++) assert(svalues[i] == nullptr);
+
+  HashMap<string, int> h4 (std::move (h3));
+  assert(h3.contains_many (skeys.data (), skeys.size (), found) == 0);
+  assert(h3.contains_many (skeys.data (), 0, found) == 0);
+}
+
+/**
+ * @tests:
+ * 0. find_key (SIMD or scalar) finds every position, for every key size
+ * 1. HashMaps of integral split keys at a high load factor (long buckets,
+ * so the vectorized search runs) stay correct through inserts, erases and
+ * resizes
+ */
+void test_integral_key_search ()
+{
+  START_TEST;
+  vector<int64_t> longs;
+  vector<char> chars;
+  vector<short> shorts;
+  for (int n = 0; n < 40; n++)
+    {
+      for (int i = 0; i < n; i++)
+        {
+          assert(find_key (longs.data (), n, longs[i]) == i);
+          assert(find_key (chars.data (), n, chars[i]) == i);
+          assert(find_key (shorts.data (), n, shorts[i]) == i);
+        }
+      assert(find_key (longs.data (), n, (int64_t) -1) == -1);
+      longs.push_back (((int64_t) n << 32) | 7); // same low half
+      chars.push_back ((char) (n * 5));
+      shorts.push_back ((short) (n * 1000));
+    }
+
+  HashMap<int64_t, string, std::hash<int64_t>, std::equal_to<int64_t>,
+      false, true> h1;
+  h1.set_load_factors (8, 1); // about 8 pairs per bucket
+  for (int64_t i = 0; i < 2000; i++) h1.insert (i << 32, to_string (i));
+  assert(h1.size () == 2000 && h1.capacity () == 256);
+  for (int64_t i = 0; i < 2000; i++)
+    {
+      assert(h1.at (i << 32) == to_string (i));
+      assert(!h1.contains_key ((i << 32) + 1));
+    }
+  for (int64_t i = 0; i < 2000; i += 2) assert(h1.erase (i << 32));
+  for (int64_t i = 0; i < 2000; i++)
+    {
+      assert(h1.contains_key (i << 32) == (i % 2 == 1));
+    }
+
+  typedef HashMap<char, int, std::hash<char>, std::equal_to<char>, false,
+      true> char_map;
+  char_map h2;
+  h2.set_load_factors (16, 1);
+  h2.set_incremental_rehash (true);
+  for (int i = 0; i < 128; i++) h2[(char) i] = i;
+  for (int i = 0; i < 128; i++) assert(h2.at ((char) i) == i);
+  char_map h3 (h2);
+  assert(h3 == h2 && h3.erase ('a') && !h3.contains_key ('a'));
+  assert(h3.size () == 127 && h3.at ('b') == 'b');
+}
+
+/**
+ * @tests:
+ * 0. split keys (an opt-in) of large values find every key
+ * 1. every layout (pairs only, split keys, split keys with cached hashes)
+ * gives the same results
+ */
+struct large_record {
+    int64_t id;
+    char payload[248];
+};
+
+template<class Map>
+void check_layout (Map &h1)
+{
+  for (int i = 0; i < 3000; i++) h1.insert (to_string (i), to_string (-i));
+  for (int i = 0; i < 3000; i += 3) assert(h1.erase (to_string (i)));
+  for (int i = 0; i < 3000; i++)
+    {
+      assert(h1.contains_key (to_string (i)) == (i % 3 != 0));
+    }
+  assert(h1.size () == 2000 && h1.at ("1") == "-1");
+}
+
+void test_split_key_layout ()
+{
+  START_TEST;
+  HashMap<int64_t, large_record, std::hash<int64_t>, std::equal_to<int64_t>,
+      false, true> h1;
+  for (int64_t i = 0; i < 500; i++)
+    {
+      large_record record;
+      record.id = i;
+      record.payload[0] = (char) i;
+      h1.insert (i * 1000003, record);
+    }
+  for (int64_t i = 0; i < 500; i++)
+    {
+      assert(h1.at (i * 1000003).id == i);
+      assert(!h1.contains_key (i * 1000003 + 1));
+    }
+
+  HashMap<string, string, std::hash<string>, std::equal_to<string>, false,
+      false> h2;
+  HashMap<string, string, std::hash<string>, std::equal_to<string>, false,
+      true> h3;
+  HashMap<string, string, std::hash<string>, std::equal_to<string>, true,
+      true> h4;
+  check_layout (h2);
+  check_layout (h3);
+  check_layout (h4);
+
+  HashMap<key_struct, large_record> h5;
+  large_record record;
+  record.id = 7;
+  h5.insert ({"a", 2}, record);
+  assert(h5.contains_key ({"a", 2}) && !h5.contains_key ({"a", 1}));
+  assert(h5.at ({"a", 2}).id == 7);
+}
+
+/**
+ * @tests:
+ * 0. iteration visits every pair exactly once on sparse maps, during an
+ * incremental resize, and after erases, rehashes, copies and moves
+ */
+template<class Map>
+int count_pairs (const Map &h1)
+{
+  int counter = 0;
+  for (auto it = h1.begin (); it != h1.end (); ++it) counter++;
+  return counter;
+}
+
+void test_sparse_iteration ()
+{
+  START_TEST;
+  HashMap<int, int> h1;
+  h1.set_min_capacity (1 << 16);
+  assert(count_pairs (h1) == 0 && h1.begin () == h1.end ());
+  h1.insert (65535, 1);
+  h1.insert (3, 2);
+  h1.insert (64, 3);
+  assert(count_pairs (h1) == 3);
+  long long sum = 0;
+  for (const auto &pair : h1) sum += pair.second;
+  assert(sum == 6);
+  h1.erase (3);
+  h1.erase (65535);
+  assert(count_pairs (h1) == 1 && h1.begin ()->first == 64);
+  h1.erase (64);
+  assert(count_pairs (h1) == 0);
+
+  HashMap<int, int> h2;
+  h2.set_incremental_rehash (true);
+  for (int i = 0; i < 5000; i++)
+    {
+      h2.insert (i, i);
+      if (i % 97 == 0)
+        {
+          assert(count_pairs (h2) == h2.size ());
+        }
+    }
+  for (int i = 0; i < 5000; i += 2)
+    {
+      h2.erase (i);
+      if (i % 101 == 0)
+        {
+          assert(count_pairs (h2) == h2.size ());
+        }
+    }
+  sum = 0;
+  for (const auto &pair : h2) sum += pair.first;
+  assert(sum == 2500LL * 2500); // sum of the odd numbers below 5000
+  h2.rehash (1 << 14);
+  assert(count_pairs (h2) == 2500);
+  HashMap<int, int> h3 (h2);
+  HashMap<int, int> h4 (std::move (h2));
+  assert(count_pairs (h3) == 2500 && count_pairs (h4) == 2500);
+  assert(count_pairs (h2) == 0);
+  h2.insert (1, 1);
+  assert(count_pairs (h2) == 1);
+  h4.clear ();
+  assert(count_pairs (h4) == 0);
+}
+
+/**
+ * @tests:
+ * 0. OrderedHashMap iterates in insertion order, also after erases,
+ * batched compactions and growth
+ * 1. duplicate keys in the vector constructor keep the first position and
+ * the last value
+ * 2. copy, move and equality
+ */
+void test_ordered_hash_map ()
+{
+  START_TEST;
+  OrderedHashMap<int, int> h1;
+  for (int i = 0; i < 1000; i++) h1.insert ((i * 7919) % 1000, i);
+  assert(h1.size () == 1000 && !h1.insert (0, 5));
+  int ind = 0;
+  for (const auto &pair : h1)
+    {
+      assert(pair.first == (ind * 7919) % 1000 && pair.second == ind);
+      ind++;
+    }
+  for (int i = 0; i < 1000; i += 3) assert(h1.erase ((i * 7919) % 1000));
+  assert(!h1.erase (-1) && h1.size () == 666);
+  ind = 0;
+  for (const auto &pair : h1)
+    {
+      while (ind % 3 == 0) ind++;
+      assert(pair.second == ind);
+      ind++;
+    }
+  for (int i = 0; i < 1000; i++)
+    {
+      assert(h1.contains_key ((i * 7919) % 1000) == (i % 3 != 0));
+    }
+  h1[-5] = 7;
+  assert(h1.at (-5) == 7 && h1.size () == 667);
+  int last = 0;
+  for (auto it = h1.begin (); it != h1.end (); it++) last = it->first;
+  assert(last == -5);
+  h1.shrink_to_fit ();
+  assert(h1.capacity () == 2048 && h1.at (-5) == 7);
+
+  OrderedHashMap<string, int> h2 ({"b", "a", "b", "c"}, {1, 2, 3, 4});
+  assert(h2.size () == 3 && h2.at ("b") == 3);
+  string order;
+  for (const auto &pair : h2) order += pair.first;
+  assert(order == "bac");
+  assert(h2.try_get ("z") == nullptr && *h2.try_get ("c") == 4);
+
+  OrderedHashMap<string, int> h3 (h2);
+  assert(h3 == h2);
+  h3.erase ("a");
+  h3.insert ("a", 2);
+  assert(h3 == h2); // same pairs, other order
+  order.clear ();
+  for (const auto &pair : h3) order += pair.first;
+  assert(order == "bca");
+  OrderedHashMap<string, int> h4 (std::move (h3));
+  assert(h4 == h2 && h3.empty () && !h3.contains_key ("a"));
+  h3["x"] = 1;
+  assert(h3.size () == 1 && h3.begin ()->first == "x");
+  h4.clear ();
+  assert(h4.empty () && h4.begin () == h4.end ());
+}
+
+/**
+ * @tests:
+ * 0. ranges (n) split the pairs into disjoint spans that cover them all
+ * 1. parallel_for_each and parallel_reduce visit every pair once, also on
+ * a skewed map and during an incremental resize
+ * 2. an exception thrown by fn reaches the caller
+ */
+void test_parallel_iteration ()
+{
+  START_TEST;
+  HashMap<int, int> h1;
+  h1.set_incremental_rehash (true);
+  for (int i = 1; i <= 7000; i++) h1.insert (i, i);
+  assert(h1.is_resizing ());
+  for (int n : {1, 3, 64, 100000})
+    {
+      auto spans = h1.ranges (n);
+      assert((int) spans.size () <= n);
+      int counter = 0;
+      for (auto &span : spans)
+        {
+          assert(span.first != span.second);
+          for (auto it = span.first; it != span.second; ++it) counter++;
+        }
+      assert(counter == 7000);
+    }
+  assert((HashMap<int, int> ().ranges (4).empty ()));
+
+  std::atomic<long long> sum (0);
+  parallel_for_each (h1, [&sum] (const std::pair<int, int> &pair)
+  { sum += pair.second; }, 4);
+  assert(sum == 24503500LL);
+  long long total = parallel_reduce (h1, 0LL,
+      [] (long long acc, const std::pair<int, int> &pair)
+      { return acc + pair.first; },
+      [] (long long a, long long b) { return a + b; }, 4);
+  assert(total == 24503500LL);
+
+  HashMap<key_struct, int> h2; // every key in the same bucket
+  for (int i = 0; i < 300; i++) h2.insert ({to_string (i), 0}, 1);
+  int pairs = parallel_reduce (h2, 0,
+      [] (int acc, const std::pair<key_struct, int> &pair)
+      { return acc + pair.second; },
+      [] (int a, int b) { return a + b; }, 3);
+  assert(pairs == 300);
+  // One result per worker, even of a type packed in bits
+  for (int key : {1, 7000, 7001})
+    {
+      bool found = parallel_reduce (h1, false,
+          [key] (bool acc, const std::pair<int, int> &pair)
+          { return acc || pair.first == key; },
+          [] (bool a, bool b) { return a || b; }, 4);
+      assert(found == (key <= 7000));
+    }
+
+  bool thrown = false;
+  try
+    {
+      parallel_for_each (h1, [] (const std::pair<int, int> &pair)
+      {
+        if (pair.first == 77) throw std::logic_error ("fn");
+      }, 4);
+    }
+  catch (const std::logic_error &)
+    {
+      thrown = true;
+    }
+  assert(thrown);
+}
+
+/**
+ * @tests:
+ * 0. the key fingerprint depends only on the set of keys
+ * 1. operator== agrees with a pair by pair comparison, for the same and
+ * for different capacities, insertion orders and during a resize
+ */
+void test_fast_equality ()
+{
+  START_TEST;
+  HashMap<int, int> h1, h2;
+  for (int i = 0; i < 500; i++) h1.insert (i, i);
+  for (int i = 499; i >= 0; i--) h2.insert (i, i);
+  assert(h1.fingerprint () == h2.fingerprint () && h1 == h2);
+  h2.erase (7);
+  assert(h1.fingerprint () != h2.fingerprint () && h1 != h2);
+  h2.insert (7, 8);
+  assert(h1.fingerprint () == h2.fingerprint () && h1 != h2); // value
+  h2[7] = 7;
+  assert(h1 == h2);
+  h2.erase (7);
+  h2.insert (1000, 7); // same size, other key
+  assert(h1 != h2 && h2 != h1);
+
+  HashMap<int, int> h3;
+  h3.reserve (100000); // other capacity
+  for (int i = 0; i < 500; i++) h3.insert (i, i);
+  assert(h3 == h1 && h1 == h3 && h3.capacity () != h1.capacity ());
+  HashMap<int, int> h4 (h1);
+  assert(h4.fingerprint () == h1.fingerprint () && h4 == h1);
+  HashMap<int, int> h5 (std::move (h4));
+  assert(h4.fingerprint () == 0 && h5 == h1);
+  h5.clear ();
+  assert(h5.fingerprint () == 0 && h5 == h4);
+
+  HashMap<string, string> h6 ({"a", "b", "c"}, {"1", "2", "3"});
+  HashMap<string, string> h7;
+  h7.set_incremental_rehash (true);
+  for (int i = 0; i < 100; i++) h7[to_string (i)] = "x";
+  for (int i = 0; i < 100; i++) h7.erase (to_string (i));
+  h7.insert ("c", "3");
+  h7.insert ("b", "2");
+  h7.insert ("a", "1");
+  assert(h6 == h7 && h6.fingerprint () == h7.fingerprint ());
+  h7.at ("a") = "0";
+  assert(h6 != h7);
+}
+
+void test_erase_iterator ()
+{
+  START_TEST;
+  HashMap<int, int> h1;
+  for (int i = 0; i < 1000; i++) h1.insert (i, i);
+  int cap = h1.capacity (), visited = 0;
+  for (auto it = h1.mbegin (); it != h1.mend ();)
+    {
+      visited++;
+      if (it->first % 2) it = h1.erase (it);
+      else { it->second = -it->first; ++it; }
+    }
+  assert(visited == 1000 && h1.size () == 500 && h1.capacity () == cap);
+  for (int i = 0; i < 1000; i++)
+    assert(i % 2 ? !h1.contains_key (i) : h1.at (i) == -i);
+  // The sweep kept the bookkeeping of the keys in sync
+  HashMap<int, int> kept;
+  for (int i = 0; i < 1000; i += 2) kept.insert (i, -i);
+  assert(h1 == kept && h1.fingerprint () == kept.fingerprint ());
+  assert((std::is_const<std::remove_reference<decltype (h1.mbegin ()->first)>
+      ::type>::value));
+  auto found = h1.find (10);
+  auto next = h1.erase (found);
+  assert(!h1.contains_key (10) && h1.size () == 499);
+  assert(next == h1.end () || next->first % 2 == 0);
+
+  // One final shrink, to where single erases would have left it
+  HashMap<int, int> h2, h3;
+  for (int i = 0; i < 1000; i++) { h2.insert (i, i); h3.insert (i, i); }
+  assert(h2.erase_if ([] (const std::pair<int, int> &p)
+                      { return p.first >= 10; }) == 990);
+  for (int i = 10; i < 1000; i++) h3.erase (i);
+  assert(h2.size () == 10 && h2 == h3 && h2.capacity () == h3.capacity ());
+  assert(h2.erase_if ([] (const std::pair<int, int> &) { return false; })
+         == 0 && h2.size () == 10);
+  assert(h2.erase_if ([] (const std::pair<int, int> &) { return true; })
+         == 10 && h2.empty () && h2.capacity () == ERASE_LAST_INIT);
+  h2.insert (1, 1);
+  assert(h2.at (1) == 1);
+
+  // Cached hashes, split keys, an ongoing incremental resize, min capacity
+  HashMap<string, string> h4;
+  h4.set_incremental_rehash (true);
+  h4.set_min_capacity (64);
+  for (int i = 0; i < 200; i++) h4[to_string (i)] = to_string (i);
+  assert(h4.is_resizing ());
+  assert(h4.erase_if ([] (const std::pair<string, string> &p)
+                      { return p.first.size () > 1; }) == 190);
+  assert(h4.size () == 10 && h4.capacity () == 64);
+  for (int i = 0; i < 200; i++)
+    assert(h4.contains_key (to_string (i)) == (i < 10));
+  HashMap<long, large_record> h5;
+  for (long i = 0; i < 200; i++) h5[i].id = i;
+  h5.erase_if ([] (const std::pair<long, large_record> &p)
+               { return p.first % 3 == 0; });
+  for (long i = 0; i < 200; i++)
+    assert(i % 3 ? h5.at (i).id == i : !h5.contains_key (i));
+
+  // String keys take transparent lookups, yet erase (it) erases at it
+  HashMap<string, int> h6;
+  for (int i = 0; i < 100; i++) h6[to_string (i)] = i;
+  for (auto it = h6.mbegin (); it != h6.mend ();)
+    it = it->second % 2 ? h6.erase (it) : ++it;
+  assert(h6.size () == 50);
+  for (int i = 0; i < 100; i++)
+    assert(h6.contains_key (to_string (i)) == (i % 2 == 0));
+  h6.erase (h6.find ("0"));
+  assert(h6.erase ("2") && !h6.erase ("3") && h6.size () == 48);
+
+  // Dictionary keeps the erase at iterator of HashMap
+  Dictionary d1;
+  for (int i = 0; i < 100; i++) d1[to_string (i)] = to_string (i % 3);
+  for (auto it = d1.mbegin (); it != d1.mend ();)
+    it = it->second == "0" ? d1.erase (it) : ++it;
+  assert(d1.size () == 66);
+  for (int i = 0; i < 100; i++)
+    assert(d1.contains_key (to_string (i)) == (i % 3 != 0));
+  d1.erase (d1.find ("1"));
+  assert(d1.erase ("2") && d1.size () == 64);
+}
+
+// Value whose copies throw while fail is set
+struct throwing_copy {
+    static bool fail;
+    static int copies; // Copies that still succeed while fail is set
+    int id;
+    explicit throwing_copy (int id = 0) : id (id) {}
+    throwing_copy (const throwing_copy &other) : id (other.id) {
+      if (fail && copies-- <= 0) throw std::runtime_error ("copy");
+    }
+    throwing_copy &operator= (const throwing_copy &) = default;
+};
+bool throwing_copy::fail = false;
+int throwing_copy::copies = 0;
+
+void test_small_hash_map ()
+{
+  START_TEST;
+  SmallHashMap<string, int, 4> s1;
+  assert(s1.empty () && s1.is_small () && s1.begin () == s1.end ());
+  for (int i = 0; i < 4; i++) assert(s1.insert (to_string (i), i));
+  assert(!s1.insert ("0", 7) && s1.at ("0") == 0);
+  assert(s1.is_small () && s1.size () == 4 && s1.capacity () == 4);
+  int sum = 0;
+  for (const auto &it : s1) sum += it.second;
+  assert(sum == 6);
+
+  s1["4"] = 4; // promotes
+  assert(!s1.is_small () && s1.size () == 5);
+  for (int i = 0; i < 5; i++) assert(s1.at (to_string (i)) == i);
+  for (int i = 5; i < 50; i++) s1.insert (to_string (i), i);
+  sum = 0;
+  for (const auto &it : s1) sum += it.second;
+  assert(sum == 49 * 50 / 2 && s1.contains_key ("49"));
+  for (int i = 49; i >= 3; i--) assert(s1.erase (to_string (i)));
+  assert(!s1.is_small () && s1.size () == 3);
+  assert(s1.erase ("2")); // down to N / 2, demotes
+  assert(s1.is_small () && s1.size () == 2 && s1.try_get ("2") == nullptr);
+  assert(!s1.erase ("2") && s1.erase ("0") && s1["1"] == 1);
+  bool thrown = false;
+  try { s1.at ("0"); } catch (const std::invalid_argument &) { thrown = true; }
+  assert(thrown);
+
+  // Copy, move and compare, inline and promoted
+  SmallHashMap<string, int, 4> s2 ({"a", "b", "a"}, {1, 2, 3});
+  assert(s2.size () == 2 && s2.at ("a") == 3);
+  SmallHashMap<string, int, 4> s3 (s2), s4;
+  assert(s3 == s2 && s3 != s4);
+  for (int i = 0; i < 10; i++) s4[to_string (i)] = i;
+  SmallHashMap<string, int, 4> s5 (s4);
+  assert(s5 == s4 && !s5.is_small ());
+  s3 = s4;
+  assert(s3 == s4 && s3.size () == 10);
+  s3 = std::move (s2);
+  assert(s3.size () == 2 && s2.empty () && s2.is_small ());
+  s2 = std::move (s5);
+  assert(s2 == s4 && s5.empty ());
+  s5["x"] = 1;
+  assert(s5.size () == 1);
+  s4.clear ();
+  assert(s4.empty () && s4.is_small ());
+
+  // A promotion that throws leaves the inline pairs as they were
+  SmallHashMap<int, throwing_copy, 4> s7;
+  for (int i = 0; i < 4; i++) s7.insert (i, throwing_copy (i));
+  throwing_copy::fail = true;
+  thrown = false;
+  try { s7.insert (4, throwing_copy (4)); }
+  catch (const std::runtime_error &) { thrown = true; }
+  throwing_copy::fail = false;
+  assert(thrown && s7.is_small () && s7.size () == 4);
+  for (int i = 0; i < 4; i++) assert(s7.at (i).id == i);
+  assert(s7.insert (4, throwing_copy (4)) && !s7.is_small ());
+  assert(s7.at (4).id == 4 && s7.at (0).id == 0);
+  assert(s7.erase (4) && s7.erase (3) && !s7.is_small ());
+  throwing_copy::fail = true;
+  throwing_copy::copies = 1; // demote builds one pair, then throws
+  thrown = false;
+  try { s7.erase (2); }
+  catch (const std::runtime_error &) { thrown = true; }
+  throwing_copy::fail = false;
+  assert(thrown && !s7.is_small () && s7.size () == 2);
+  assert(s7.at (0).id == 0 && s7.at (1).id == 1 && !s7.contains_key (2));
+  assert(s7.erase (1) && s7.is_small () && s7.at (0).id == 0);
+  assert((std::is_nothrow_move_constructible<SmallHashMap<int, int>>::value));
+  assert((!std::is_nothrow_move_constructible<decltype (s7)>::value));
+  SmallHashMap<int, int> s6;
+  for (int i = 0; i < SMALL_INLINE_CAPACITY; i++) s6[i] = i;
+  assert(s6.is_small ());
+}
+
+#if __cplusplus >= 201703L
+constexpr auto frozen_keywords = make_frozen_map<std::string_view, int>
+    ({{"GET", 1}, {"PUT", 2}, {"POST", 3}, {"DELETE", 4}, {"HEAD", 5},
+      {"OPTIONS", 6}, {"PATCH", 7}, {"TRACE", 8}, {"CONNECT", 9}});
+static_assert (frozen_keywords.at ("PATCH") == 7, "built at compile time");
+static_assert (!frozen_keywords.contains_key ("GETS"), "missing key");
+#endif
+constexpr auto frozen_ports = make_frozen_map<int, char>
+    ({{80, 'h'}, {443, 's'}, {22, 'x'}, {25, 'm'}, {53, 'd'}, {8080, 'p'}});
+static_assert (frozen_ports.at (443) == 's', "built at compile time");
+static_assert (!frozen_ports.contains_key (81), "missing key");
+
+void test_frozen_map ()
+{
+  START_TEST;
+  bool thrown = false;
+#if __cplusplus >= 201703L
+  assert(frozen_keywords.size () == 9 && frozen_keywords["GET"] == 1);
+  assert(frozen_keywords.try_get ("get") == nullptr);
+  int sum = 0, count = 0;
+  for (auto it : frozen_keywords) { sum += it.second; count++; }
+  assert(sum == 45 && count == 9);
+  try { frozen_keywords.at ("LINK"); }
+  catch (const std::invalid_argument &) { thrown = true; }
+  assert(thrown);
+#endif
+  assert(frozen_ports.size () == 6 && frozen_ports[22] == 'x');
+  assert(frozen_ports.try_get (21) == nullptr);
+  string letters;
+  for (auto it : frozen_ports) letters += it.second;
+  std::sort (letters.begin (), letters.end ());
+  assert(letters == "dhmpsx");
+
+  // Built at run time too
+  std::pair<int, int> items[500];
+  for (int i = 0; i < 500; i++) items[i] = {i * 7919, i};
+  auto *frozen = new FrozenMap<int, int, 500> (items);
+  for (int i = 0; i < 500; i++) assert(frozen->at (i * 7919) == i);
+  for (int i = 0; i < 500; i++) assert(!frozen->contains_key (i * 7919 + 1));
+  delete frozen;
+  items[1].first = items[0].first;
+  thrown = false;
+  try { FrozenMap<int, int, 500> duplicate (items); }
+  catch (const std::invalid_argument &) { thrown = true; }
+  assert(thrown);
+}
+
+struct constant_hash {
+    size_t operator() (int) const { return 7; }
+};
+
+struct collide_odd_hash {
+    size_t operator() (int key) const { return key % 2 ? 1 : key; }
+};
+
+void test_freeze ()
+{
+  START_TEST;
+  HashMap<string, int> h1;
+  for (int i = 0; i < 5000; i++) h1[to_string (i)] = i;
+  FrozenHashMap<string, int, string_hash, std::equal_to<>> f1 = h1.freeze ();
+  assert(f1.size () == 5000 && !f1.empty ());
+  for (int i = 0; i < 5000; i++) assert(f1.at (to_string (i)) == i);
+  for (int i = 5000; i < 6000; i++)
+    assert(!f1.contains_key (to_string (i)) && !f1.try_get (to_string (i)));
+  long long sum = 0;
+  for (const auto &it : f1) sum += it.second;
+  assert(sum == 4999LL * 5000 / 2);
+  assert(f1.memory_usage () < 5000 * (sizeof (std::pair<string, int>) + 2)
+                              + sizeof (f1));
+  bool thrown = false;
+  try { f1["x"]; } catch (const std::invalid_argument &) { thrown = true; }
+  assert(thrown);
+
+  // Every size, from empty up, and equality
+  for (int n = 0; n < 40; n++)
+    {
+      HashMap<int, int> h2;
+      for (int i = 0; i < n; i++) h2[i * 31] = i;
+      auto f2 = h2.freeze ();
+      assert(f2.size () == n);
+      for (int i = 0; i < n; i++) assert(f2[i * 31] == i);
+      assert(!f2.contains_key (-1));
+    }
+  FrozenHashMap<int, int, std::hash<int>, std::equal_to<int>> f3, f4
+      ({1, 2, 1}, {10, 20, 30});
+  assert(f3.empty () && f4.size () == 2 && f4.at (1) == 30);
+  auto f5 = HashMap<int, int> ({2, 1}, {20, 30}).freeze ();
+  assert(f4 == f5 && f3 != f4);
+
+  // Also the base of Dictionary
+  HashMap<string, string> h6 ({"a", "b"}, {"1", "2"});
+  assert(h6.freeze ().at ("b") == "2");
+
+  // Keys no hash tells apart are frozen too, past the slots
+  HashMap<int, int, constant_hash> h7;
+  for (int i = 0; i < 100; i++) h7.insert (i, -i);
+  auto f7 = h7.freeze ();
+  assert(f7.size () == 100);
+  for (int i = 0; i < 100; i++) assert(f7.at (i) == -i);
+  assert(!f7.contains_key (100) && !f7.try_get (-1));
+  sum = 0;
+  for (const auto &it : f7) sum += it.second;
+  assert(sum == -4950 && f7 == h7.freeze ());
+
+  // Some keys collide, the others get slots
+  HashMap<int, int, collide_odd_hash> h8;
+  for (int i = 0; i < 1000; i++) h8.insert (i, i);
+  auto f8 = h8.freeze ();
+  for (int i = 0; i < 1000; i++) assert(f8.at (i) == i);
+  assert(!f8.contains_key (1001) && !f8.contains_key (1000));
+
+  // String keys and values share one arena, every value right after its key
+  HashMap<string, string> h9;
+  for (int i = 0; i < 500; i++)
+    h9[string (40, 'k') + to_string (i)] = string (50, 'v') + to_string (i);
+  auto f9 = h9.freeze ();
+  assert((std::is_same<decltype (f9)::stored_key, ArenaString>::value));
+  for (int i = 0; i < 500; i++)
+    assert(f9.at (string (40, 'k') + to_string (i))
+           == string (50, 'v') + to_string (i));
+  for (const auto &it : f9)
+    assert(it.first.data () + it.first.size () == it.second.data ());
+  auto f10 (f9);
+  decltype (f9) f11;
+  f11 = f9;
+  f9 = decltype (f9) (); // copies keep their own arena
+  assert(f9.empty () && f10 == h9.freeze () && f11 == f10);
+  assert(f11.at (string (40, 'k') + "7") == string (50, 'v') + "7");
+  // A KeyEqual that takes only strings keeps the keys strings
+  assert((std::is_same<FrozenHashMap<string, string, std::hash<string>,
+      std::equal_to<string>>::stored_key, string>::value));
+}
+
+void test_snapshot ()
+{
+  START_TEST;
+  const char *path = "test_ex6_snapshot.bin";
+  HashMap<string, string> h1;
+  for (int i = 0; i < 3000; i++) h1[to_string (i)] = string (i % 50, 'v');
+  h1.save_snapshot (path);
+  {
+    MappedDictionary m1 = MappedDictionary::open (path, true);
+    assert(m1.size () == 3000 && m1.verify ());
+    for (int i = 0; i < 3000; i++)
+      assert(m1.at (to_string (i)) == string (i % 50, 'v'));
+    assert(!m1.contains_key ("3000") && !m1.contains_key (""));
+    int count = 0;
+    for (auto it : m1)
+      {
+        assert(it.second == h1.at (it.first.str ()));
+        count++;
+      }
+    assert(count == 3000);
+    MappedDictionary m2 (std::move (m1));
+    assert(m2.at ("7").size () == 7 && m1.empty ());
+    bool thrown = false;
+    try { m2.at ("x"); } catch (const std::invalid_argument &) { thrown = true; }
+    assert(thrown);
+    thrown = false; // other value type
+    try { MappedHashMap<string, int>::open (path); }
+    catch (const std::runtime_error &) { thrown = true; }
+    assert(thrown);
+  }
+
+  // Trivially copyable values are read in place
+  HashMap<int, double> h2;
+  for (int i = 0; i < 100; i++) h2[i] = i / 2.0;
+  h2.save_snapshot (path);
+  auto m3 = MappedHashMap<int, double>::open (path);
+  const double &value = m3.at (99);
+  assert(value == 49.5 && m3.size () == 100 && !m3.contains_key (100));
+  HashMap<int, double> ().save_snapshot (path);
+  assert((MappedHashMap<int, double>::open (path, true).empty ()));
+
+  // Keys are hashed and compared as bytes: no floating point or padding
+  assert(snapshot_key<long>::value && snapshot_key<string>::value);
+  assert(!snapshot_key<double>::value && !snapshot_key<large_record>::value);
+  enum class shade { light, dark };
+  HashMap<shade, int> h3;
+  h3[shade::dark] = 1;
+  h3.save_snapshot (path);
+  assert((MappedHashMap<shade, int>::open (path, true).at (shade::dark) == 1));
+
+  // A changed byte fails the checksum, a cut file the header
+  h1.save_snapshot (path);
+  {
+    std::fstream file (path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp (-1, std::ios::end);
+    file.put ('x');
+  }
+  assert(!MappedDictionary::open (path).verify ());
+  bool thrown = false;
+  try { MappedDictionary::open (path, true); }
+  catch (const std::runtime_error &) { thrown = true; }
+  assert(thrown);
+  std::ofstream (path, std::ios::binary) << "EX6SNAP";
+  thrown = false;
+  try { MappedDictionary::open (path); }
+  catch (const std::runtime_error &) { thrown = true; }
+  assert(thrown);
+  std::remove (path);
+  thrown = false;
+  try { MappedDictionary::open (path); }
+  catch (const std::runtime_error &) { thrown = true; }
+  assert(thrown);
+}
+
+void test_dictionary_load_tsv ()
+{
+  START_TEST;
+  const char *path = "test_ex6_load.tsv";
+  {
+    std::ofstream out (path, std::ios::binary);
+    out << "key\tvalue\n";
+    for (int i = 0; i < 200000; i++)
+      out << "k" << i << "\t" << string (i % 40, 'x') << "\ty\r\n";
+    out << "\nk7\tlast"; // empty line, then a duplicate with no newline
+  }
+  Dictionary d1;
+  tsv_options options;
+  options.skip_header = true;
+  options.threads = 4;
+  d1.load_tsv (path, options);
+  assert(d1.size () == 200000 && !d1.contains_key ("key"));
+  for (int i = 0; i < 200000; i += 997)
+    assert(d1.at ("k" + to_string (i)) == string (i % 40, 'x') + "\ty");
+  assert(d1.at ("k7") == "last" && d1.at ("k0") == "\ty");
+  Dictionary d2;
+  for (int i = 0; i < 200000; i++)
+    d2["k" + to_string (i)] = string (i % 40, 'x') + "\ty";
+  d2["k7"] = "last";
+  assert(d1 == d2 && d1.capacity () == d2.capacity ());
+  Dictionary d4; // parsed and inserted on one thread
+  options.threads = 1;
+  d4.load_tsv (path, options);
+  assert(d4 == d1 && d4.capacity () == d1.capacity ());
+
+  // CSV into a dictionary with pairs, header kept
+  {
+    std::ofstream out (path, std::ios::binary);
+    out << "a,1\nb,2,3\n";
+  }
+  Dictionary d3 ({"a", "c"}, {"0", "0"});
+  options = tsv_options ();
+  options.delimiter = ',';
+  d3.load_tsv (path, options);
+  assert(d3.size () == 3 && d3.at ("a") == "1" && d3.at ("b") == "2,3");
+
+  bool thrown = false;
+  { std::ofstream out (path, std::ios::binary); out << "a\t1\nb\n"; }
+  try { d3.load_tsv (path); }
+  catch (const std::invalid_argument &) { thrown = true; }
+  assert(thrown);
+  { std::ofstream out (path, std::ios::binary); }
+  d3.load_tsv (path); // empty file
+  assert(d3.size () == 3);
+  std::remove (path);
+  thrown = false;
+  try { d3.load_tsv (path); }
+  catch (const std::runtime_error &) { thrown = true; }
+  assert(thrown);
+}
+
+void test_arena_dictionary ()
+{
+  START_TEST;
+  ArenaDictionary d1;
+  for (int i = 0; i < 20000; i++)
+    assert(d1.insert ("key" + to_string (i), string (100, 'a' + i % 26)));
+  assert(!d1.insert ("key0", "other") && d1.size () == 20000);
+  assert(d1.at ("key25") == string (100, 'z') && d1["key0"][0] == 'a');
+  assert(d1.live_bytes () > 2000000 && d1.dead_bytes () == 0);
+  assert(d1.arena_bytes () < d1.live_bytes () + 2 * ARENA_CHUNK_BYTES);
+  ArenaString key ("key1");
+  assert(d1.contains_key (key) && d1.contains_key (string ("key2")));
+
+  // Erased bytes are reclaimed once they outnumber the live ones
+  size_t full = d1.arena_bytes ();
+  for (int i = 0; i < 15000; i++) assert(d1.erase ("key" + to_string (i)));
+  assert(!d1.erase ("key0") && d1.size () == 5000);
+  assert(d1.dead_bytes () < d1.live_bytes () && d1.arena_bytes () < full);
+  for (int i = 15000; i < 20000; i++)
+    assert(d1.at ("key" + to_string (i)) == string (100, 'a' + i % 26));
+  d1.assign ("key15000", "");
+  d1.assign ("new", "value");
+  assert(d1.at ("key15000").empty () && d1.at ("new") == "value");
+  assert(string (d1.at ("new")) == "value" && d1.at ("new").size () == 5);
+  int count = 0;
+  for (const auto &it : d1) count += it.first.substr (0, 3) == "key";
+  assert(count == 5000 && d1.size () == 5001);
+
+  // Copies get their own arena
+  ArenaDictionary d2 ({"a", "b", "a"}, {"1", "2", "3"});
+  ArenaDictionary d3 (d2);
+  d2.assign ("b", "x");
+  assert(d3.at ("a") == "3" && d3.at ("b") == "2" && d3 != d2);
+  ArenaDictionary d4 (std::move (d2));
+  assert(d4.at ("b") == "x" && d2.empty () && d2.live_bytes () == 0);
+  d2.insert ("c", "3");
+  assert(d2.at ("c") == "3" && d4.size () == 2);
+  d4 = d3;
+  assert(d4 == d3);
+  d4.clear ();
+  assert(d4.empty () && d4.arena_bytes () == 0);
+  bool thrown = false;
+  try { d4.at ("a"); } catch (const std::invalid_argument &) { thrown = true; }
+  assert(thrown);
+}
+
+/**
+ * A transparent hash that counts the keys it hashes, by type
+ */
+struct counting_string_hash {
+  typedef void is_transparent;
+  static int strings, pointers;
+  size_t operator() (const string &s) const
+  { strings++; return string_hash () (s); }
+  size_t operator() (const char *s) const
+  { pointers++; return string_hash () (s); }
+};
+int counting_string_hash::strings = 0;
+int counting_string_hash::pointers = 0;
+
+void test_heterogeneous_lookup ()
+{
+  START_TEST;
+  // Equal characters hash equally whatever their type
+  assert(string_hash () ("key") == string_hash () (string ("key")));
+  Dictionary d1 ({"a", "b", "c"}, {"1", "2", "3"});
+  const char *key = "b";
+  assert(d1.contains_key (key) && !d1.contains_key ("z"));
+  assert(d1.at (key) == "2" && d1["c"] == "3" && *d1.try_get ("a") == "1");
+  assert(d1.find ("a")->second == "1" && d1.find ("z") == d1.end ());
+  assert(d1.get_or ("z", "none") == "none");
+  d1["d"] = "4";
+  assert(d1.size () == 4 && d1.at (string ("d")) == "4");
+  assert(d1.erase ("d") && d1.size () == 3 && !d1.contains_key ("d"));
+  const Dictionary &d2 = d1;
+  assert(d2.at ("a") == "1" && d2["b"] == "2" && d2.find ("c") != d2.end ());
+  bool thrown = false;
+  try { d2.at ("z"); } catch (const std::invalid_argument &) { thrown = true; }
+  assert(thrown);
+  // A byte range, as load_tsv reads keys, in every standard
+  ArenaString bytes ("abc", 1);
+  assert(d1.contains_key (bytes) && d1.at (bytes) == "1");
+  assert(string_hash () (bytes) == string_hash () ("a"));
+#if __cplusplus >= 201703L
+  std::string_view view ("abc", 1);
+  assert(d1.contains_key (view) && d1.at (view) == "1");
+  d1[std::string_view ("efg", 1)] = "5";
+  assert(d1.at ("e") == "5");
+#endif
+
+  // A transparent map hashes the given key, and builds a string only to
+  // insert it
+  HashMap<string, int, counting_string_hash, std::equal_to<>> m1;
+  for (int i = 0; i < 100; i++) m1[to_string (i)] = i;
+  counting_string_hash::strings = counting_string_hash::pointers = 0;
+  assert(m1.at ("42") == 42 && m1.contains_key ("7") && !m1.erase ("x"));
+  assert(counting_string_hash::strings == 0);
+  assert(counting_string_hash::pointers == 3);
+  m1["new"] = -1;
+  assert(m1.size () == 101 && m1.at (string ("new")) == -1);
+
+  // String keys get these policies by default, a plain map looks up a
+  // const char * as it is
+  assert(is_transparent<hash_default<string>::type>::value);
+  assert(is_transparent<key_equal_default<string>::type>::value);
+  HashMap<string, int> m2;
+  m2["a"] = 1;
+  assert(m2.at ("a") == 1 && m2.contains_key ("a") && m2.erase ("a"));
+  assert(!m2.contains_key ("a") && m2.get_or ("a", -1) == -1);
+
+  // Maps of other policies still convert the key
+  HashMap<string, int, std::hash<string>, std::equal_to<string>> m3;
+  m3["a"] = 1;
+  assert(m3.at ("a") == 1 && m3.contains_key ("a") && m3.erase ("a"));
+}
+
 int main ()
 {
   typedef void (*test_func) ();
@@ -1038,7 +2552,32 @@ int main ()
 //      test_invalid_key_exception,
       test_capacity_edge_cases,
       test_special_key_types,
-      test_const_correctness
+      test_const_correctness,
+      test_flat_hash_map,
+      test_robin_hood_hash_map,
+      test_incremental_rehash,
+      test_move_semantics,
+      test_hash_policies,
+      test_cached_hash,
+      test_find_and_try_get,
+      test_read_modify_write,
+      test_capacity_management,
+      test_bulk_construction,
+      test_batched_lookup,
+      test_integral_key_search,
+      test_split_key_layout,
+      test_sparse_iteration,
+      test_ordered_hash_map,
+      test_parallel_iteration,
+      test_fast_equality,
+      test_erase_iterator,
+      test_small_hash_map,
+      test_frozen_map,
+      test_freeze,
+      test_snapshot,
+      test_dictionary_load_tsv,
+      test_arena_dictionary,
+      test_heterogeneous_lookup
   };
 
   int i = 0, passed = 0, counter = 0;